@@ -0,0 +1,582 @@
+// author: Daniel Hug, 2022
+
+// benchmarks of the di8joy library, runnable on every platform
+//
+// Each section measures one part of the input path and prints its results:
+//
+//   decode     buffered DirectInput events: offset table vs. search of the offsets
+//   edges      button edges of 8 devices: bit masks vs. bool arrays
+//   record     recording of an hour of input of 4 devices, and its replay at max. speed
+//   synthetic  update() at 1 kHz with 8 synthetic devices of 128 buttons: cost, edge loss, latency
+//   scaling    cost of update() by the number of connected devices, up to max_nJoystick
+//   axes       conversion and use of axis positions in the representation of this build
+//              (di8joy_bench_float and di8joy_bench_int16 are built for the comparison)
+//
+// usage: di8joy_bench [section ...] (all sections if none is given)
+
+#include "di8joy/di8joy.hpp"
+#include "di8joy/di8joy_decode.hpp"
+#include "di8joy/di8joy_record.hpp"
+#include "di8joy/di8joy_state.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using hd::js;
+using namespace hd::priv;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// keeps results of measured code from being optimized away
+volatile std::uint64_t sink;
+
+// value below which fraction of the values are
+double percentile(std::vector<double> values, double fraction)
+{
+    const auto n = static_cast<std::size_t>(fraction * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(n), values.end());
+    return values[n];
+}
+
+// nanoseconds per operation of n operations done by f()
+template <typename F>
+double nsPerOp(std::size_t n, F f)
+{
+    const auto start = Clock::now();
+    f();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(n);
+}
+
+////////////////////////////////////////////////////////////
+// decode: buffered DirectInput events
+////////////////////////////////////////////////////////////
+
+struct ObjectData // offset and data of a DIDEVICEOBJECTDATA
+{
+    unsigned int offset;
+    unsigned int data;
+};
+
+// offsets of the controls in DIJOYSTATE2 (DIJOFS_*) of a device with all controls
+struct Offsets
+{
+    int axes[js::max_nAxis];
+    int povs[js::max_nPOV];
+    int buttons[js::max_nButton];
+
+    Offsets()
+    {
+        for (int i = 0; i < js::max_nAxis; ++i)
+            axes[i] = 4 * i;
+        for (int i = 0; i < js::max_nPOV; ++i)
+            povs[i] = 32 + 4 * i;
+        for (int i = 0; i < js::max_nButton; ++i)
+            buttons[i] = 48 + i;
+    }
+};
+
+// events of a busy device: mostly buttons, some axes and povs
+std::vector<ObjectData> makeEvents(const Offsets &offsets, std::size_t n)
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> axis(0, js::max_nAxis - 1);
+    std::uniform_int_distribution<int> pov(0, js::max_nPOV - 1);
+    std::uniform_int_distribution<int> button(0, js::max_nButton - 1);
+    std::uniform_int_distribution<unsigned int> position(0, 0xFFFF);
+    std::uniform_int_distribution<unsigned int> direction(0, 8);
+
+    std::vector<ObjectData> events(n);
+    for (ObjectData &event : events)
+    {
+        const int kind = percent(random);
+        if (kind < 70)
+            event = {static_cast<unsigned int>(offsets.buttons[button(random)]), (random() & 1) ? 0x80u : 0u};
+        else if (kind < 95)
+            event = {static_cast<unsigned int>(offsets.axes[axis(random)]), position(random)};
+        else
+        {
+            const unsigned int d = direction(random);
+            event = {static_cast<unsigned int>(offsets.povs[pov(random)]), (d < 8) ? d * 4500 : 0xFFFFu};
+        }
+    }
+
+    return events;
+}
+
+// the decode without a table: search the axis, button and pov offsets for the offset of each event
+jsControl searchControl(const Offsets &offsets, unsigned int offset)
+{
+    for (int i = 0; i < js::max_nAxis; ++i)
+    {
+        if (offsets.axes[i] == static_cast<int>(offset))
+            return {jsControl::Axis, static_cast<unsigned char>(i)};
+    }
+    for (int i = 0; i < js::max_nButton; ++i)
+    {
+        if (offsets.buttons[i] == static_cast<int>(offset))
+            return {jsControl::Button, static_cast<unsigned char>(i)};
+    }
+    for (int i = 0; i < js::max_nPOV; ++i)
+    {
+        if (offsets.povs[i] == static_cast<int>(offset))
+            return {jsControl::Pov, static_cast<unsigned char>(i)};
+    }
+    return {};
+}
+
+void benchDecode()
+{
+    const Offsets offsets;
+    jsDecodeTable table;
+    table.build(offsets.axes, offsets.povs, offsets.buttons);
+
+    const std::vector<ObjectData> events = makeEvents(offsets, 1000000);
+
+    std::uint64_t found = 0;
+
+    const double lookup = nsPerOp(events.size(), [&] {
+        for (const ObjectData &event : events)
+            found += table.lookup(event.offset).index;
+    });
+
+    const double search = nsPerOp(events.size(), [&] {
+        for (const ObjectData &event : events)
+            found += searchControl(offsets, event.offset).index;
+    });
+
+    jsState state;
+    const double decode = nsPerOp(events.size(), [&] {
+        for (const ObjectData &event : events)
+            found += table.decode(state, event.offset, event.data).kind;
+    });
+
+    sink = found;
+
+    std::cout << "decode: " << events.size() << " events (70% buttons, 25% axes, 5% povs)\n"
+              << "  offset table lookup   " << lookup << " ns/event\n"
+              << "  offset search         " << search << " ns/event\n"
+              << "  table decode to state " << decode << " ns/event\n";
+}
+
+////////////////////////////////////////////////////////////
+// edges: button edges of 8 devices
+////////////////////////////////////////////////////////////
+
+void benchEdges()
+{
+    constexpr unsigned int nDevice = 8;
+    constexpr std::size_t nUpdate = 100000;
+    constexpr unsigned int togglesPerUpdate = 4; // per device
+
+    struct BoolButtons // the former button state: one bool per button
+    {
+        bool buttons[js::max_nButton]{};
+    };
+
+    // the same button states of all devices after each update in both representations
+    std::vector<js::ButtonMask> masks(nUpdate * nDevice);
+    std::vector<BoolButtons> bools(nUpdate * nDevice);
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<unsigned int> button(0, js::max_nButton - 1);
+    js::ButtonMask state[nDevice];
+
+    for (std::size_t u = 0; u < nUpdate; ++u)
+    {
+        for (unsigned int d = 0; d < nDevice; ++d)
+        {
+            for (unsigned int t = 0; t < togglesPerUpdate; ++t)
+            {
+                const unsigned int b = button(random);
+                state[d].set(b, !state[d].test(b));
+            }
+            masks[u * nDevice + d] = state[d];
+            for (unsigned int b = 0; b < js::max_nButton; ++b)
+                bools[u * nDevice + d].buttons[b] = state[d].test(b);
+        }
+    }
+
+    std::uint64_t found = 0;
+
+    // edges by XOR/AND of the masks, set bits visited with countr_zero
+    const double mask = nsPerOp(nUpdate, [&] {
+        js::ButtonMask published[nDevice];
+        for (std::size_t u = 0; u < nUpdate; ++u)
+        {
+            for (unsigned int d = 0; d < nDevice; ++d)
+            {
+                const js::ButtonMask &next = masks[u * nDevice + d];
+                const js::ButtonMask changed = published[d] ^ next;
+                (changed & next).forEach([&](unsigned int b) { found += b; });
+                (changed & published[d]).forEach([&](unsigned int b) { found -= b; });
+                published[d] = next;
+            }
+        }
+    });
+
+    // edges by comparing each button
+    const double scan = nsPerOp(nUpdate, [&] {
+        BoolButtons published[nDevice];
+        for (std::size_t u = 0; u < nUpdate; ++u)
+        {
+            for (unsigned int d = 0; d < nDevice; ++d)
+            {
+                const BoolButtons &next = bools[u * nDevice + d];
+                for (unsigned int b = 0; b < js::max_nButton; ++b)
+                {
+                    if (published[d].buttons[b] == next.buttons[b])
+                        continue;
+                    if (next.buttons[b])
+                        found += b;
+                    else
+                        found -= b;
+                }
+                published[d] = next;
+            }
+        }
+    });
+
+    sink = found;
+
+    std::cout << "edges: " << nDevice << " devices, " << js::max_nButton << " buttons, " << togglesPerUpdate
+              << " toggles per device and update\n"
+              << "  bit masks   " << mask << " ns/update (" << sizeof(js::ButtonMask) << " bytes per device)\n"
+              << "  bool arrays " << scan << " ns/update (" << sizeof(BoolButtons) << " bytes per device)\n";
+}
+
+////////////////////////////////////////////////////////////
+// record: recording and replay at max. speed
+////////////////////////////////////////////////////////////
+
+void benchRecord()
+{
+    constexpr unsigned int nDevice = 4;
+    constexpr std::size_t nUpdate = 1000000;       // an hour of input at one update per 3.6 ms
+    constexpr std::chrono::microseconds interval{3600};
+    constexpr unsigned int eventsPerUpdate = 2;    // per update, of random devices
+
+    const std::string path = (std::filesystem::temp_directory_path() / "di8joy_bench.j2kr").string();
+
+    jsCaps caps;
+    caps.nButton = 32;
+    caps.nPOV = 1;
+    for (unsigned int a = 0; a < 4; ++a)
+        caps.axes[a] = true;
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<unsigned int> device(0, nDevice - 1);
+    std::uniform_int_distribution<unsigned int> button(0, caps.nButton - 1);
+    std::uniform_int_distribution<unsigned int> axis(0, 3);
+    std::uniform_real_distribution<float> position(-100.f, 100.f);
+
+    // the events of all updates, generated before recording them
+    const auto start = js::Event::Clock::now();
+    std::vector<std::vector<js::Event>> updates(nUpdate);
+    js::ButtonMask buttons[nDevice];
+
+    for (std::size_t u = 0; u < nUpdate; ++u)
+    {
+        for (unsigned int e = 0; e < eventsPerUpdate; ++e)
+        {
+            js::Event event;
+            event.joystick = static_cast<unsigned char>(device(random));
+            event.time = start + u * interval;
+            event.sequence = static_cast<std::uint32_t>(u);
+
+            if (random() % 4 == 0)
+            {
+                event.type = js::Event::AxisMoved;
+                event.index = static_cast<unsigned char>(axis(random));
+                event.axisPosition = js::axisFromPercent(position(random));
+            }
+            else
+            {
+                const unsigned int b = button(random);
+                buttons[event.joystick].set(b, !buttons[event.joystick].test(b));
+                event.type = buttons[event.joystick].test(b) ? js::Event::ButtonPressed : js::Event::ButtonReleased;
+                event.index = static_cast<unsigned char>(b);
+            }
+
+            updates[u].push_back(event);
+        }
+    }
+
+    const std::size_t nEvent = nUpdate * eventsPerUpdate;
+
+    // recording: update() hands over the events of each update, the writer thread writes them
+    jsRecorder recorder;
+    const double record = nsPerOp(nEvent, [&] {
+        if (!recorder.start(path))
+            return;
+        for (unsigned int d = 0; d < nDevice; ++d)
+            recorder.recordConnect(d, caps, js::Id());
+        for (const std::vector<js::Event> &events : updates)
+        {
+            recorder.record(events, caps.nButton);
+            recorder.flush();
+        }
+        recorder.stop();
+    });
+
+    const auto fileSize = std::filesystem::file_size(path);
+
+    // replay at max. speed: decode and mapping through update()
+    std::size_t replayed = 0;
+    const double replay = nsPerOp(nEvent, [&] {
+        if (!js::startReplay(path, false))
+            return;
+        while (js::isReplaying())
+        {
+            js::update();
+            for (unsigned int d = 0; d < nDevice; ++d)
+                replayed += js::getEvents(d).size();
+        }
+        js::stopReplay();
+    });
+
+    std::remove(path.c_str());
+
+    std::cout << "record: " << nEvent << " events of " << nDevice << " devices in "
+              << std::chrono::duration_cast<std::chrono::minutes>(nUpdate * interval).count() << " min of input, "
+              << fileSize << " bytes\n"
+              << "  recording              " << record << " ns/event (" << 1e3 / record << " M events/s)\n"
+              << "  replay at max. speed   " << replay << " ns/event (" << 1e3 / replay << " M events/s, "
+              << replayed << " events replayed)\n";
+}
+
+////////////////////////////////////////////////////////////
+// synthetic: load test with the synthetic backend
+////////////////////////////////////////////////////////////
+
+void benchSynthetic()
+{
+    constexpr unsigned int nDevice = std::min<unsigned int>(8, js::max_nJoystick);
+    constexpr std::chrono::milliseconds tick{1};
+    constexpr unsigned int nTick = 2000;
+
+    js::SyntheticDevice device;
+    device.nButton = js::max_nButton;
+    device.nAxis = std::min<unsigned int>(4, js::max_nAxis);
+    device.nPOV = 1;
+    device.buttonRate = 1000.f;
+    device.axisRate = 1000.f;
+    device.povRate = 10.f;
+
+    js::startSynthetic(std::vector<js::SyntheticDevice>(nDevice, device));
+
+    std::vector<double> costs;     // of each update(), us
+    std::vector<double> latencies; // from the time of an event until the end of its update(), us
+    std::size_t buttonEvents = 0;
+    std::size_t edges = 0;
+
+    // first update: open the devices
+    js::update();
+
+    const auto begin = Clock::now();
+    for (unsigned int t = 1; t <= nTick; ++t)
+    {
+        std::this_thread::sleep_until(begin + t * tick);
+
+        const auto start = Clock::now();
+        js::update();
+        const auto end = Clock::now();
+        costs.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+
+        for (unsigned int d = 0; d < nDevice; ++d)
+        {
+            for (const js::Event &event : js::getEvents(d))
+            {
+                latencies.push_back(std::chrono::duration<double, std::micro>(end - event.time).count());
+                if ((event.type == js::Event::ButtonPressed) || (event.type == js::Event::ButtonReleased))
+                    buttonEvents += (event.index < device.nButton);
+            }
+
+            // buttons toggled twice within one update cancel out in the edges
+            const js::ButtonEdges buttonEdges = js::getButtonEdges(d);
+            for (unsigned int b = 0; b < device.nButton; ++b)
+                edges += buttonEdges.pressed.test(b) + buttonEdges.released.test(b);
+        }
+    }
+
+    unsigned int overflows = 0;
+    for (unsigned int d = 0; d < nDevice; ++d)
+        overflows += js::getOverflowCount(d);
+
+    js::stopSynthetic();
+
+    std::cout << "synthetic: " << nDevice << " devices of " << device.nButton << " buttons, " << nTick
+              << " updates at 1 kHz, " << latencies.size() << " events\n"
+              << "  update()   p50 " << percentile(costs, 0.5) << " us, p99 " << percentile(costs, 0.99)
+              << " us, max " << *std::max_element(costs.begin(), costs.end()) << " us\n"
+              << "  latency    p50 " << percentile(latencies, 0.5) << " us, p99 " << percentile(latencies, 0.99)
+              << " us, max " << *std::max_element(latencies.begin(), latencies.end()) << " us\n"
+              << "  edges      " << edges << " of " << buttonEvents << " button events ("
+              << buttonEvents - edges << " cancelled within an update), " << overflows << " overflows\n";
+}
+
+////////////////////////////////////////////////////////////
+// scaling: update() cost by the number of connected devices
+////////////////////////////////////////////////////////////
+
+void benchScaling()
+{
+    constexpr std::chrono::milliseconds tick{1};
+    constexpr unsigned int nTick = 500;
+
+    js::SyntheticDevice device;
+    device.nButton = std::min<unsigned int>(32, js::max_nButton);
+    device.buttonRate = 500.f;
+    device.axisRate = 500.f;
+
+    std::cout << "scaling: update() at 1 kHz, devices of " << device.nButton << " buttons with "
+              << device.buttonRate + device.axisRate + device.povRate << " changes/s, capacity "
+              << js::max_nJoystick << " devices\n";
+
+    for (unsigned int nDevice = 0; nDevice <= js::max_nJoystick; nDevice = (nDevice == 0) ? 1 : 2 * nDevice)
+    {
+        js::startSynthetic(std::vector<js::SyntheticDevice>(nDevice, device));
+
+        // first update: open the devices
+        js::update();
+
+        std::vector<double> costs;
+        const auto begin = Clock::now();
+        for (unsigned int t = 1; t <= nTick; ++t)
+        {
+            std::this_thread::sleep_until(begin + t * tick);
+
+            const auto start = Clock::now();
+            js::update();
+            costs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+
+        js::stopSynthetic();
+
+        double mean = 0.0;
+        for (double cost : costs)
+            mean += cost / nTick;
+
+        std::cout << "  " << nDevice << " devices: update() mean " << mean << " us, p50 " << percentile(costs, 0.5)
+                  << " us";
+        if (nDevice > 0)
+            std::cout << ", " << mean / nDevice << " us per device";
+        std::cout << "\n";
+    }
+}
+
+////////////////////////////////////////////////////////////
+// axes: axis representation (float percent or int16)
+////////////////////////////////////////////////////////////
+
+void benchAxes()
+{
+    constexpr std::size_t n = 1000000;
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> raw(-32768, 32767);
+    std::uniform_int_distribution<unsigned int> axis(0, js::max_nAxis - 1);
+
+    std::vector<ObjectData> events(n);
+    std::vector<std::int32_t> values(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const int value = raw(random);
+        events[i] = {4 * axis(random), static_cast<unsigned int>(value) & 0xFFFFu};
+        values[i] = value;
+    }
+
+    const Offsets offsets;
+    jsDecodeTable table;
+    table.build(offsets.axes, offsets.povs, offsets.buttons);
+
+    std::uint64_t found = 0;
+
+    // buffered DirectInput events: signed 16 bit device values
+    jsState state;
+    const double decode = nsPerOp(n, [&] {
+        for (const ObjectData &event : events)
+            found += table.decode(state, event.offset, event.data).index;
+    });
+
+    // evdev: device values with minimum and range of the axis
+    js::axis_t sum{};
+    const double range = nsPerOp(n, [&] {
+        for (std::int32_t value : values)
+            sum += axisFromRange(value, -32768, 65535) / 4;
+    });
+
+    // mapping logic: compare every axis of a state with a threshold
+    const js::axis_t threshold = js::axisFromPercent(50.f);
+    std::vector<js::State> states(n / js::max_nAxis);
+    for (std::size_t i = 0; i < states.size(); ++i)
+    {
+        for (unsigned int a = 0; a < js::max_nAxis; ++a)
+            states[i].axes[a] = axisFromRaw16(static_cast<std::int16_t>(values[i * js::max_nAxis + a]));
+    }
+    const double compare = nsPerOp(states.size() * js::max_nAxis, [&] {
+        for (const js::State &s : states)
+        {
+            for (js::axis_t position : s.axes)
+                found += (position > threshold);
+        }
+    });
+
+    sink = found + static_cast<std::uint64_t>(sum != js::axis_t{});
+
+#if defined(DI8JOY_AXIS_INT16)
+    const char *representation = "int16";
+#else
+    const char *representation = "float";
+#endif
+
+    std::cout << "axes: " << representation << " (" << sizeof(js::axis_t) << " bytes per axis, " << sizeof(js::State)
+              << " bytes per state)\n"
+              << "  decode of raw 16 bit values " << decode << " ns/event\n"
+              << "  conversion from a range     " << range << " ns/sample\n"
+              << "  threshold comparison        " << compare << " ns/axis\n";
+}
+
+////////////////////////////////////////////////////////////
+
+struct Section
+{
+    const char *name;
+    void (*run)();
+};
+
+const Section sections[] = {
+    {"decode", benchDecode},
+    {"edges", benchEdges},
+    {"record", benchRecord},
+    {"synthetic", benchSynthetic},
+    {"scaling", benchScaling},
+    {"axes", benchAxes},
+};
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    for (const Section &section : sections)
+    {
+        bool selected = (argc < 2);
+        for (int i = 1; i < argc; ++i)
+            selected |= (section.name == std::string(argv[i]));
+
+        if (selected)
+            section.run();
+    }
+
+    return 0;
+}
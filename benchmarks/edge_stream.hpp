@@ -0,0 +1,115 @@
+// author: Daniel Hug, 2022
+
+#ifndef EDGE_STREAM_HPP
+#define EDGE_STREAM_HPP
+
+// synthetic button edge streams for the benchmarks of the binding engine:
+// 100 distinct button edges per 1 ms tick (100k edges/s) over 32 joysticks x 32 buttons,
+// and a profile binding a key stroke to each of their presses and releases
+
+#include "joy2key/joy2key_binding.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+
+using namespace hd::j2k;
+using hd::js;
+
+constexpr unsigned int nJoystick = std::min<unsigned int>(32, js::max_nJoystick);
+constexpr unsigned int nButton = std::min<unsigned int>(32, js::max_nButton);
+constexpr unsigned int edgesPerTick = 100; // 100k edges/s at 1 ms per tick
+
+struct Tick // edges of the joysticks reported by one update()
+{
+    std::vector<unsigned int> joysticks;
+    std::vector<js::ButtonEdges> edges;
+};
+
+inline Profile makeProfile(const std::string &name)
+{
+    Profile profile;
+    profile.name = name;
+
+    for (unsigned int j = 0; j < nJoystick; ++j)
+    {
+        for (unsigned int b = 0; b < nButton; ++b)
+        {
+            for (Edge edge : {Press, Release})
+            {
+                Binding binding;
+                binding.joystick = j;
+                binding.button = b;
+                binding.edge = edge;
+                binding.name = "action";
+                binding.keys = {KeyStroke{LShift, 0, static_cast<std::uint16_t>('A' + b % 26)}};
+                profile.bindings.push_back(binding);
+            }
+        }
+    }
+
+    return profile;
+}
+
+inline std::vector<Tick> makeStream(unsigned int nTick, unsigned int seed = 1)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<unsigned int> joystick(0, nJoystick - 1);
+    std::uniform_int_distribution<unsigned int> button(0, nButton - 1);
+
+    std::vector<js::ButtonMask> state(nJoystick);
+    std::vector<Tick> stream(nTick);
+
+    for (Tick &tick : stream)
+    {
+        const std::vector<js::ButtonMask> before = state;
+
+        // distinct buttons: two toggles of a button within a tick would cancel out
+        for (unsigned int e = 0; e < edgesPerTick;)
+        {
+            const unsigned int j = joystick(random);
+            const unsigned int b = button(random);
+            if (state[j].test(b) != before[j].test(b))
+                continue;
+            state[j].set(b, !state[j].test(b));
+            ++e;
+        }
+
+        for (unsigned int j = 0; j < nJoystick; ++j)
+        {
+            const js::ButtonMask changed = before[j] ^ state[j];
+            if (!changed.any())
+                continue;
+
+            js::ButtonEdges edges;
+            edges.pressed = changed & state[j];
+            edges.released = changed & before[j];
+            tick.joysticks.push_back(j);
+            tick.edges.push_back(edges);
+        }
+    }
+
+    return stream;
+}
+
+inline unsigned int countEdges(const std::vector<Tick> &stream)
+{
+    unsigned int count = 0;
+    for (const Tick &tick : stream)
+    {
+        for (const js::ButtonEdges &edges : tick.edges)
+        {
+            edges.pressed.forEach([&](unsigned int) { ++count; });
+            edges.released.forEach([&](unsigned int) { ++count; });
+        }
+    }
+    return count;
+}
+
+} // namespace bench
+
+#endif // EDGE_STREAM_HPP
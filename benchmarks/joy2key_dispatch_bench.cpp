@@ -0,0 +1,99 @@
+// author: Daniel Hug, 2022
+
+// dispatch of button edges through a compiled BindingTable
+//
+// A synthetic edge stream of 100k edges/s (100 edges per 1 ms tick, random buttons of
+// 32 joysticks) is generated up front and then dispatched as fast as possible. Reported
+// are the cost per edge, the worst tick and the share of the real time the stream
+// would take, compared with a search through the configured bindings per edge.
+//
+// usage: joy2key_dispatch_bench [seconds of input, default 5]
+
+#include "benchmarks/edge_stream.hpp"
+#include "joy2key/joy2key_binding.hpp"
+#include "joy2key/joy2key_timer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace bench;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// run dispatchTick(tick) for all ticks, report total and worst tick
+template <typename Dispatch>
+void measure(const char *name, const std::vector<Tick> &stream, unsigned int nEdge, Dispatch dispatchTick)
+{
+    Clock::duration worst{};
+    const auto start = Clock::now();
+
+    for (const Tick &tick : stream)
+    {
+        const auto tickStart = Clock::now();
+        dispatchTick(tick);
+        worst = std::max(worst, Clock::now() - tickStart);
+    }
+
+    const std::chrono::duration<double> total = Clock::now() - start;
+    const double realTime = static_cast<double>(stream.size()) * 1e-3; // 1 ms per tick
+
+    std::cout << name << ": " << total.count() * 1e9 / nEdge << " ns/edge, worst tick "
+              << std::chrono::duration<double, std::micro>(worst).count() << " us, "
+              << 100.0 * total.count() / realTime << " % of real time\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    const unsigned int seconds = (argc > 1) ? static_cast<unsigned int>(std::max(std::atoi(argv[1]), 1)) : 5;
+
+    const Profile profile = makeProfile("bench");
+    BindingTable table;
+    if (!table.compile(profile))
+        return 1;
+
+    const std::vector<Tick> stream = makeStream(seconds * 1000);
+    const unsigned int nEdge = countEdges(stream);
+
+    std::cout << nEdge << " edges in " << seconds << " s of input (" << nEdge / seconds << " edges/s), "
+              << table.getActionCount() << " bound edges\n";
+
+    PressTimer timer;
+    std::uint64_t keys = 0;
+    const auto time = PressTimer::Clock::now();
+
+    measure("binding table", stream, nEdge, [&](const Tick &tick) {
+        for (std::size_t i = 0; i < tick.joysticks.size(); ++i)
+            table.dispatch(tick.joysticks[i], tick.edges[i], time, timer, [&](const Action &action) { keys += action.nKey; });
+    });
+
+    // what the table replaces: search the configured bindings for each edge
+    measure("binding search", stream, nEdge, [&](const Tick &tick) {
+        for (std::size_t i = 0; i < tick.joysticks.size(); ++i)
+        {
+            auto search = [&](unsigned int button, Edge edge) {
+                for (const Binding &binding : profile.bindings)
+                {
+                    if ((binding.joystick == tick.joysticks[i]) && (binding.button == button) && (binding.edge == edge))
+                    {
+                        keys += binding.keys.size();
+                        break;
+                    }
+                }
+            };
+            tick.edges[i].pressed.forEach([&](unsigned int button) { search(button, Press); });
+            tick.edges[i].released.forEach([&](unsigned int button) { search(button, Release); });
+        }
+    });
+
+    std::cout << "(" << keys << " key strokes)\n";
+
+    return 0;
+}
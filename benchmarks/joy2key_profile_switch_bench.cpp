@@ -0,0 +1,138 @@
+// author: Daniel Hug, 2022
+
+// profile switching while input streams in
+//
+// The dispatch thread works through a synthetic edge stream (100k edges/s, see
+// edge_stream.hpp) in real time, one tick per millisecond, and measures the latency of
+// each tick. It runs three times: without switching, while it selects another profile every
+// tick and a second thread requests profiles at about 10 kHz, and additionally while a
+// third thread reloads all profiles every 10 ms (new generations, deferred reclamation).
+// Switching must not show up in the tick latencies.
+//
+// Latencies include the preemption of the dispatch thread by the switching threads on
+// machines with fewer cores than threads.
+//
+// usage: joy2key_profile_switch_bench [seconds of input, default 5]
+
+#include "benchmarks/edge_stream.hpp"
+#include "joy2key/joy2key_profiles.hpp"
+#include "joy2key/joy2key_timer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace bench;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr unsigned int nProfile = 8;
+
+std::vector<Profile> makeProfiles()
+{
+    std::vector<Profile> profiles;
+    for (unsigned int p = 0; p < nProfile; ++p)
+        profiles.push_back(makeProfile("profile " + std::to_string(p)));
+    return profiles;
+}
+
+double percentile(std::vector<double> &latencies, double fraction)
+{
+    const auto n = static_cast<std::size_t>(fraction * static_cast<double>(latencies.size() - 1));
+    std::nth_element(latencies.begin(), latencies.begin() + static_cast<std::ptrdiff_t>(n), latencies.end());
+    return latencies[n];
+}
+
+void run(const char *name, const std::vector<Tick> &stream, bool switching, bool reloading)
+{
+    const std::vector<Profile> profiles = makeProfiles();
+    ProfileSet set;
+    set.load(profiles);
+
+    std::atomic<bool> done{false};
+    std::atomic<unsigned long> requests{0};
+    std::atomic<unsigned long> reloads{0};
+    std::vector<std::thread> threads;
+
+    if (switching)
+    {
+        threads.emplace_back([&] {
+            for (unsigned int p = 0; !done.load(std::memory_order_relaxed); ++p)
+            {
+                set.request(p % nProfile);
+                requests.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+    }
+
+    if (reloading)
+    {
+        threads.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed))
+            {
+                set.load(profiles);
+                reloads.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+    }
+
+    PressTimer timer;
+    std::uint64_t keys = 0;
+    std::vector<double> latencies;
+    latencies.reserve(stream.size());
+    const auto time = PressTimer::Clock::now();
+    const auto begin = Clock::now();
+
+    for (std::size_t t = 0; t < stream.size(); ++t)
+    {
+        std::this_thread::sleep_until(begin + std::chrono::milliseconds(t));
+
+        const Tick &tick = stream[t];
+        const auto start = Clock::now();
+
+        const BindingTable &table = set.table();
+        for (std::size_t i = 0; i < tick.joysticks.size(); ++i)
+            table.dispatch(tick.joysticks[i], tick.edges[i], time, timer, [&](const Action &action) { keys += action.nKey; });
+        if (switching)
+            set.select(static_cast<unsigned int>(t % nProfile));
+        set.quiescent();
+
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    done.store(true);
+    for (std::thread &thread : threads)
+        thread.join();
+
+    std::cout << name << ": tick latency p50 " << percentile(latencies, 0.5) << " us, p99 "
+              << percentile(latencies, 0.99) << " us, p99.9 " << percentile(latencies, 0.999) << " us, max "
+              << *std::max_element(latencies.begin(), latencies.end()) << " us (" << requests.load() << " requests, "
+              << reloads.load() << " reloads, " << keys << " key strokes)\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    const unsigned int seconds = (argc > 1) ? static_cast<unsigned int>(std::max(std::atoi(argv[1]), 1)) : 5;
+
+    const std::vector<Tick> stream = makeStream(seconds * 1000);
+
+    std::cout << countEdges(stream) << " edges in " << stream.size() << " ticks, " << nProfile << " profiles, "
+              << std::thread::hardware_concurrency() << " hardware threads\n";
+
+    run("no switching", stream, false, false);
+    run("switching", stream, true, false);
+    run("switching and reloading", stream, true, true);
+
+    return 0;
+}
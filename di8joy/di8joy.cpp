@@ -47,7 +47,7 @@ namespace hd
 bool js::isConnected(unsigned int jsIdx)
 {
     assert(jsIdx < js::max_nJoystick);
-    return priv::jsMngr::getInstance().getState(jsIdx).connected;
+    return priv::jsMngr::getInstance().isConnected(jsIdx);
 }
 
 unsigned int js::getButtonCount(unsigned int jsIdx)
@@ -65,27 +65,64 @@ unsigned int js::getPovCount(unsigned int jsIdx)
 bool js::hasAxis(unsigned int jsIdx, Axis axisIdx)
 {
     assert(jsIdx < js::max_nJoystick);
-    return priv::jsMngr::getInstance().getCapabilities(jsIdx).axes[axisIdx];
+    return (static_cast<unsigned int>(axisIdx) < js::max_nAxis) &&
+           priv::jsMngr::getInstance().getCapabilities(jsIdx).axes[axisIdx];
+}
+
+int js::getPovButton(unsigned int jsIdx, unsigned int povIdx, PovButton position)
+{
+    assert(jsIdx < js::max_nJoystick);
+    assert(povIdx < js::max_nPOV);
+    const priv::jsCaps caps = priv::jsMngr::getInstance().getCapabilities(jsIdx);
+    return priv::hasPovButtons(caps, povIdx) ? static_cast<int>(priv::povButtonBase(caps, povIdx) + position) : -1;
 }
 
 bool js::isButtonPressed(unsigned int jsIdx, unsigned int buttonIdx)
 {
     assert(jsIdx < js::max_nJoystick);
     assert(buttonIdx < js::max_nButton);
-    return priv::jsMngr::getInstance().getState(jsIdx).buttons[buttonIdx];
+    return priv::jsMngr::getInstance().isButtonPressed(jsIdx, buttonIdx);
+}
+
+js::ButtonEdges js::getButtonEdges(unsigned int jsIdx)
+{
+    assert(jsIdx < js::max_nJoystick);
+    return priv::jsMngr::getInstance().getButtonEdges(jsIdx);
+}
+
+const std::vector<js::Event> &js::getEvents(unsigned int jsIdx)
+{
+    assert(jsIdx < js::max_nJoystick);
+    return priv::jsMngr::getInstance().getEvents(jsIdx);
+}
+
+bool js::pollEvent(Event &event)
+{
+    return priv::jsMngr::getInstance().pollEvent(event);
+}
+
+bool js::waitEvent(Event &event, std::chrono::milliseconds timeout)
+{
+    return priv::jsMngr::getInstance().waitEvent(event, timeout);
+}
+
+unsigned int js::getDroppedEventCount()
+{
+    return priv::jsMngr::getInstance().getDroppedEventCount();
 }
 
 int js::getPovPosition(unsigned int jsIdx, unsigned int povIdx)
 {
     assert(jsIdx < js::max_nJoystick);
     assert(povIdx < js::max_nPOV);
-    return priv::jsMngr::getInstance().getState(jsIdx).povs[povIdx];
+    return priv::jsMngr::getInstance().getPovPosition(jsIdx, povIdx);
 }
 
-float js::getAxisPosition(unsigned int jsIdx, Axis axisIdx)
+js::axis_t js::getAxisPosition(unsigned int jsIdx, Axis axisIdx)
 {
     assert(jsIdx < js::max_nJoystick);
-    return priv::jsMngr::getInstance().getState(jsIdx).axes[axisIdx];
+    assert(static_cast<unsigned int>(axisIdx) < js::max_nAxis);
+    return priv::jsMngr::getInstance().getAxisPosition(jsIdx, axisIdx);
 }
 
 js::Id js::getId(unsigned int jsIdx)
@@ -94,6 +131,102 @@ js::Id js::getId(unsigned int jsIdx)
     return priv::jsMngr::getInstance().getId(jsIdx);
 }
 
+js::State js::getState(unsigned int jsIdx)
+{
+    assert(jsIdx < js::max_nJoystick);
+    return priv::jsMngr::getInstance().getState(jsIdx);
+}
+
+std::uint64_t js::getGeneration(unsigned int jsIdx)
+{
+    assert(jsIdx < js::max_nJoystick);
+    return priv::jsMngr::getInstance().getGeneration(jsIdx);
+}
+
+unsigned int js::getOverflowCount(unsigned int jsIdx)
+{
+    assert(jsIdx < js::max_nJoystick);
+    return priv::jsMngr::getInstance().getOverflowCount(jsIdx);
+}
+
+void js::setAxisResponse(unsigned int jsIdx, Axis axisIdx, const AxisResponse &response)
+{
+    assert(jsIdx < js::max_nJoystick);
+    assert(static_cast<unsigned int>(axisIdx) < js::max_nAxis);
+    priv::jsMngr::getInstance().setAxisResponse(jsIdx, axisIdx, response);
+}
+
+js::AxisResponse js::getAxisResponse(unsigned int jsIdx, Axis axisIdx)
+{
+    assert(jsIdx < js::max_nJoystick);
+    assert(static_cast<unsigned int>(axisIdx) < js::max_nAxis);
+    return priv::jsMngr::getInstance().getAxisResponse(jsIdx, axisIdx);
+}
+
+void js::setAxisFilter(unsigned int jsIdx, Axis axisIdx, const AxisFilter &filter)
+{
+    assert(jsIdx < js::max_nJoystick);
+    assert(static_cast<unsigned int>(axisIdx) < js::max_nAxis);
+    priv::jsMngr::getInstance().setAxisFilter(jsIdx, axisIdx, filter);
+}
+
+js::AxisFilter js::getAxisFilter(unsigned int jsIdx, Axis axisIdx)
+{
+    assert(jsIdx < js::max_nJoystick);
+    assert(static_cast<unsigned int>(axisIdx) < js::max_nAxis);
+    return priv::jsMngr::getInstance().getAxisFilter(jsIdx, axisIdx);
+}
+
+bool js::waitForInput(std::chrono::milliseconds timeout)
+{
+    return priv::jsMngr::getInstance().waitForInput(timeout);
+}
+
+bool js::startRecording(const std::string &path)
+{
+    return priv::jsMngr::getInstance().startRecording(path);
+}
+
+void js::stopRecording()
+{
+    priv::jsMngr::getInstance().stopRecording();
+}
+
+bool js::startReplay(const std::string &path, bool realTime)
+{
+    return priv::jsMngr::getInstance().startReplay(path, realTime);
+}
+
+void js::stopReplay()
+{
+    priv::jsMngr::getInstance().stopReplay();
+}
+
+bool js::isReplaying()
+{
+    return priv::jsMngr::getInstance().isReplaying();
+}
+
+void js::startSynthetic(const std::vector<SyntheticDevice> &devices, unsigned int seed)
+{
+    priv::jsMngr::getInstance().startSynthetic(devices, seed);
+}
+
+void js::stopSynthetic()
+{
+    priv::jsMngr::getInstance().stopSynthetic();
+}
+
+bool js::setProfileFile(const std::string &path)
+{
+    return priv::jsMngr::getInstance().setProfileFile(path);
+}
+
+js::StartupTimes js::getStartupTimes()
+{
+    return priv::jsMngr::getInstance().getStartupTimes();
+}
+
 void js::update()
 {
     return priv::jsMngr::getInstance().update();
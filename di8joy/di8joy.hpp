@@ -41,7 +41,27 @@
 
 // implements the user API of the di8joy library
 
+#include <bit>
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <vector>
+
+// Capacities of the library, selected at compile time (CMake options DI8JOY_MAX_*).
+// All state and backend tables are sized by them: a build for a few small devices
+// keeps its whole state compact and the per-control loops short.
+#if !defined(DI8JOY_MAX_JOYSTICK)
+#define DI8JOY_MAX_JOYSTICK 32 // 1 ... 32
+#endif
+#if !defined(DI8JOY_MAX_BUTTON)
+#define DI8JOY_MAX_BUTTON 128 // 1 ... 128
+#endif
+#if !defined(DI8JOY_MAX_POV)
+#define DI8JOY_MAX_POV 4 // 1 ... 4
+#endif
+#if !defined(DI8JOY_MAX_AXIS)
+#define DI8JOY_MAX_AXIS 8 // 1 ... 8 (X, Y, Z, Rx, Ry, Rz, S0, S1 in this order)
+#endif
 
 namespace hd
 {
@@ -52,10 +72,29 @@ class js
   public:
     enum
     {
-        max_nJoystick = 8, // max. number of supported joysticks
-        max_nButton = 128, // max. number of supported buttons (incl. POV states mapped to buttons)
-        max_nPOV = 4,      // max. number of supported POV hats
-        max_nAxis = 8      // max. number of supported axes
+        max_nJoystick = DI8JOY_MAX_JOYSTICK, // max. number of supported joysticks
+        max_nButton = DI8JOY_MAX_BUTTON,     // max. number of supported buttons (incl. POV states mapped to buttons)
+        max_nPOV = DI8JOY_MAX_POV,           // max. number of supported POV hats
+        max_nAxis = DI8JOY_MAX_AXIS          // max. number of supported axes
+    };
+
+    static_assert((max_nJoystick >= 1) && (max_nJoystick <= 32), "DI8JOY_MAX_JOYSTICK must be 1 ... 32");
+    static_assert((max_nButton >= 1) && (max_nButton <= 128), "DI8JOY_MAX_BUTTON must be 1 ... 128");
+    static_assert((max_nPOV >= 1) && (max_nPOV <= 4), "DI8JOY_MAX_POV must be 1 ... 4");
+    static_assert((max_nAxis >= 1) && (max_nAxis <= 8), "DI8JOY_MAX_AXIS must be 1 ... 8");
+
+    enum PovButton // virtual buttons of the pov hats: button getPovButton(jsIdx, povIdx, PovButton)
+    {
+        PovC,  // centered
+        PovU,  // up
+        PovR,  // right
+        PovD,  // down
+        PovL,  // left
+        PovUR, // up/right
+        PovDR, // down/right
+        PovDL, // down/left
+        PovUL, // up/left
+        nPovButton
     };
 
     enum Axis
@@ -70,6 +109,123 @@ class js
         S1  // second slider
     };
 
+    // Representation of axis positions, selected at compile time (CMake option DI8JOY_AXIS_TYPE)
+#if defined(DI8JOY_AXIS_INT16)
+    using axis_t = std::int16_t; // fixed point: +/-32767 for +/-100% of full scale, no float conversion
+    static constexpr axis_t axisFull = 32767;
+#else
+    using axis_t = float; // percent: +/-100.f for +/-100% of full scale (default)
+    static constexpr axis_t axisFull = 100.f;
+#endif
+
+    static constexpr axis_t axisFromPercent(float percent) // conversions between axis_t and percent of full scale
+    {
+        percent = (percent < -100.f) ? -100.f : ((percent > 100.f) ? 100.f : percent);
+#if defined(DI8JOY_AXIS_INT16)
+        return static_cast<axis_t>(percent * (axisFull / 100.f) + ((percent < 0.f) ? -0.5f : 0.5f));
+#else
+        return percent;
+#endif
+    }
+
+    static constexpr float axisToPercent(axis_t position)
+    {
+        return static_cast<float>(position) * (100.f / static_cast<float>(axisFull));
+    }
+
+    struct ButtonMask // state of all buttons of a joystick, one bit per button
+    {
+        static constexpr unsigned int nWord = (max_nButton + 63) / 64; // 64 bit words needed for max_nButton
+
+        std::uint64_t bits[nWord]{};
+
+        bool test(unsigned int buttonIdx) const
+        {
+            return ((bits[buttonIdx / 64] >> (buttonIdx % 64)) & 1u) != 0;
+        }
+
+        void set(unsigned int buttonIdx, bool pressed)
+        {
+            const std::uint64_t bit = std::uint64_t{1} << (buttonIdx % 64);
+            bits[buttonIdx / 64] = pressed ? (bits[buttonIdx / 64] | bit) : (bits[buttonIdx / 64] & ~bit);
+        }
+
+        bool any() const
+        {
+            std::uint64_t result = 0;
+            for (std::uint64_t word : bits)
+                result |= word;
+            return result != 0;
+        }
+
+        // call f(buttonIdx) for each set bit, in ascending order
+        template <typename F>
+        void forEach(F f) const
+        {
+            for (unsigned int i = 0; i < nWord; ++i)
+            {
+                for (std::uint64_t word = bits[i]; word != 0; word &= word - 1)
+                    f(i * 64 + static_cast<unsigned int>(std::countr_zero(word)));
+            }
+        }
+
+        friend ButtonMask operator^(const ButtonMask &lhs, const ButtonMask &rhs)
+        {
+            ButtonMask result;
+            for (unsigned int i = 0; i < nWord; ++i)
+                result.bits[i] = lhs.bits[i] ^ rhs.bits[i];
+            return result;
+        }
+
+        friend ButtonMask operator&(const ButtonMask &lhs, const ButtonMask &rhs)
+        {
+            ButtonMask result;
+            for (unsigned int i = 0; i < nWord; ++i)
+                result.bits[i] = lhs.bits[i] & rhs.bits[i];
+            return result;
+        }
+
+        friend bool operator==(const ButtonMask &, const ButtonMask &) = default;
+    };
+
+    struct ButtonEdges // button changes of a joystick during the last update()
+    {
+        ButtonMask pressed;  // buttons toggled to on
+        ButtonMask released; // buttons toggled to off
+    };
+
+    struct State // state of a joystick as returned by getState()
+    {
+        bool connected{false};       // Is the joystick currently connected?
+        axis_t axes[max_nAxis]{};    // Position of each axis, in range [-axisFull, axisFull]
+        int povs[max_nPOV]{};        // Position of each pov hat (-1 for center pos, otherwise in hundredths of a degree starting from top with 0 in clockwise direction):
+                                     // center: -1, up: 0, U/R: 4500, R: 9000, D/R: 13500, D: 18000, D/L: 22500, L: 27000, U/L: 31500
+        ButtonMask buttons{};        // Status of each button (bit set = pressed)
+
+        friend bool operator==(const State &, const State &) = default;
+    };
+
+    struct Event // a button, axis or pov change as reported by the device
+    {
+        using Clock = std::chrono::steady_clock;
+
+        enum Type : unsigned char
+        {
+            ButtonPressed,
+            ButtonReleased,
+            AxisMoved,
+            PovMoved
+        };
+
+        Type type{ButtonPressed};
+        unsigned char joystick{0}; // Joystick number (jsIdx) the change belongs to
+        unsigned char index{0};    // Button, axis (Axis) or pov hat number
+        int position{0};           // New pov position for PovMoved (see State::povs), 0 otherwise
+        axis_t axisPosition{0};    // New axis position for AxisMoved, in range [-axisFull, axisFull]
+        std::uint32_t sequence{0}; // Equal for changes the device reported together, increasing otherwise
+        Clock::time_point time{};  // When the device reported the change (not when update() read it)
+    };
+
     struct Id
     {
         std::wstring name{L"No Joystick"}; // Name of the joystick
@@ -77,22 +233,151 @@ class js
         unsigned int productId{0};         // Product identifier
     };
 
+    struct AxisResponse // conditioning of the positions of an axis (see setAxisResponse())
+    {
+        enum Curve : unsigned char
+        {
+            Linear,      // proportional to the deflection
+            Exponential, // flat center, steep towards the edges: (e^(curvature * d) - 1) / (e^curvature - 1)
+            SCurve       // flat center and edges, curvature 0 ... 1 blends from linear to smoothstep
+        };
+
+        float deadzone{0.f};     // Positions within +/-deadzone around the center are 0
+        float edgeDeadzone{0.f}; // Positions beyond +/-(100 - edgeDeadzone) are +/-saturation
+        float saturation{100.f}; // Position reported at full deflection
+        Curve curve{Linear};     // Response between the deadzones
+        float curvature{0.f};    // Strength of the curve (0: linear)
+
+        friend bool operator==(const AxisResponse &, const AxisResponse &) = default;
+    };
+
+    struct AxisFilter // noise filter of an axis (see setAxisFilter())
+    {
+        float minCutoff{0.f}; // Cutoff frequency (Hz) of the low pass at rest, lower is smoother (0: no low pass),
+                              // e.g. 1.f
+        float beta{0.f};      // Rise of the cutoff frequency with the speed of the axis, higher is less lag on fast
+                              // moves, e.g. 0.05f
+        float threshold{0.f}; // Changes of the filtered position smaller than threshold are not reported, e.g. 0.5f
+
+        friend bool operator==(const AxisFilter &, const AxisFilter &) = default;
+    };
+
+    struct StartupTimes // time from the first update() until the joysticks present then were live (opened)
+    {
+        std::chrono::microseconds firstLive{-1}; // First joystick live, -1 while none is (or if there is none)
+        std::chrono::microseconds allLive{-1};   // All joysticks live or failed to open, -1 while some are pending
+    };
+
+    struct SyntheticDevice // generated joystick for load and scaling tests (see startSynthetic())
+    {
+        enum Pattern : unsigned char
+        {
+            Random,  // single changes of random controls, at random times with the given mean rates
+            Bursty,  // as Random, but burstLength changes reported together at a time
+            Scripted // the events of script, repeated in a loop
+        };
+
+        unsigned int nButton{32};       // Number of buttons (max. max_nButton)
+        unsigned int nPOV{1};           // Number of pov hats (max. max_nPOV)
+        unsigned int nAxis{4};          // Number of axes, starting at X (max. max_nAxis)
+        Pattern pattern{Random};        // How the input is generated
+        float buttonRate{10.f};         // Random/Bursty: mean button changes per second
+        float axisRate{100.f};          // Random/Bursty: mean axis changes per second
+        float povRate{2.f};             // Random/Bursty: mean pov changes per second
+        unsigned int burstLength{16};   // Bursty: changes per burst
+        std::vector<Event> script;      // Scripted: type, index and position of each event; its time is the offset
+                                        // from Clock::time_point{}, the loop restarts after the last event
+    };
+
     static bool isConnected(unsigned int jsIdx);
 
     static unsigned int getButtonCount(unsigned int jsIdx);
 
     static unsigned int getPovCount(unsigned int jsIdx);
 
-    static bool hasAxis(unsigned int jsIdx, Axis axisIdx);
+    static bool hasAxis(unsigned int jsIdx, Axis axisIdx); // false for axes beyond max_nAxis
+
+    static int getPovButton(unsigned int jsIdx, unsigned int povIdx, PovButton position); // virtual button pressed
+                                                    // while the pov hat is in that position, -1 if there is none:
+                                                    // the nPovButton buttons of each hat follow the physical buttons
 
     static bool isButtonPressed(unsigned int jsIdx, unsigned int buttonIdx);
 
+    static ButtonEdges getButtonEdges(unsigned int jsIdx); // buttons pressed/released by the last update()
+                                                           // (only to be called from the thread calling update())
+
+    static const std::vector<Event> &getEvents(unsigned int jsIdx); // changes of the last update() in the order
+                                                                   // the device reported them (only to be called
+                                                                   // from the thread calling update())
+
+    static bool pollEvent(Event &event); // take the next event of all joysticks from the event queue, false if empty;
+                                         // update() fills the queue once pollEvent() or waitEvent() have been used
+                                         // (one consumer thread, which may be the thread calling update())
+
+    static bool waitEvent(Event &event, std::chrono::milliseconds timeout); // as pollEvent(), but wait up to timeout
+                                                                            // for another thread calling update()
+
+    static unsigned int getDroppedEventCount(); // events lost because the queue was full; use getState() to resync
+
     static int getPovPosition(unsigned int jsIdx, unsigned int povIdx);
 
-    static float getAxisPosition(unsigned int jsIdx, Axis axisIdx);
+    static axis_t getAxisPosition(unsigned int jsIdx, Axis axisIdx);
 
     static js::Id getId(unsigned int jsIdx);
 
+    static State getState(unsigned int jsIdx); // consistent snapshot of all axes, povs and buttons;
+                                               // like all queries except getButtonEdges() it can be called
+                                               // from any thread while another thread calls update()
+
+    static std::uint64_t getGeneration(unsigned int jsIdx); // incremented by update() whenever the state of the
+                                                            // joystick changed: compare with the value of your
+                                                            // last look to skip unchanged joysticks
+
+    static unsigned int getOverflowCount(unsigned int jsIdx); // input buffer overflows (lost events) since the
+                                                              // joystick was connected; the state has been
+                                                              // resynchronized after each of them
+
+    // condition the positions of the axis in the state and the events from the next update() on,
+    // kept for the joystick number when the joystick changes (only from the thread calling update())
+    static void setAxisResponse(unsigned int jsIdx, Axis axisIdx, const AxisResponse &response);
+
+    static AxisResponse getAxisResponse(unsigned int jsIdx, Axis axisIdx);
+
+    // filter the positions of the axis (before their conditioning) from the next update() on: the events
+    // of the axis are replaced by one event per reported position (only from the thread calling update())
+    static void setAxisFilter(unsigned int jsIdx, Axis axisIdx, const AxisFilter &filter);
+
+    static AxisFilter getAxisFilter(unsigned int jsIdx, Axis axisIdx);
+
+    static bool waitForInput(std::chrono::milliseconds timeout); // block until a joystick has new input or one is
+                                                                 // plugged in or out (then call update()), false
+                                                                 // on timeout (only from the thread calling update())
+
+    static bool startRecording(const std::string &path); // record the events of all joysticks into a binary
+                                                         // file, written by a background thread
+    static void stopRecording();
+
+    static bool startReplay(const std::string &path, bool realTime); // replace the joysticks by a recording,
+                                                                     // replayed as recorded or at max. speed
+    static void stopReplay(); // back to the real joysticks
+
+    static bool isReplaying(); // replay started and not all of its records delivered yet
+                               // (recording and replay only from the thread calling update())
+
+    // replace the joysticks by generated ones (joystick i: devices[i]) for load tests,
+    // the same seed generates the same input
+    static void startSynthetic(const std::vector<SyntheticDevice> &devices, unsigned int seed = 1);
+    static void stopSynthetic(); // back to the real joysticks
+
+    static bool setProfileFile(const std::string &path); // keep the capability profiles of the devices in a file:
+                                                         // a device known from it is opened without enumerating
+                                                         // its controls; false if the file exists but is invalid
+                                                         // (it is rewritten then), empty path: memory only
+
+    static StartupTimes getStartupTimes(); // the joysticks are opened concurrently and go live one by one,
+                                           // the first update() does not wait for them (only from the thread
+                                           // calling update())
+
     static void update(); // normally used internally.
                           // to be called if you have no window
                           // joystick state is not updated automatically
@@ -0,0 +1,281 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+// implements the conditioning of axis positions of the di8joy library
+
+#include "di8joy_axis.hpp"
+
+#include <bit>
+#include <cmath>
+#include <numbers>
+
+namespace
+{
+
+// anonymous namespace for things to be kept private to this translation unit
+
+constexpr float derivativeCutoff = 1.f; // cutoff frequency (Hz) of the low pass of the speed of an axis
+constexpr float minInterval = 0.001f;   // interval (s) assumed between samples of the same time
+constexpr float settledDistance = 0.01f; // a filtered axis closer to its position is not moving any more
+
+// smoothing factor of a low pass with the cutoff frequency for the sample interval
+float smoothing(float cutoff, float interval)
+{
+    const float tau = 1.f / (2.f * std::numbers::pi_v<float> * cutoff);
+    return 1.f / (1.f + tau / interval);
+}
+
+} // anonymous namespace
+
+namespace hd
+{
+
+namespace priv
+{
+
+////////////////////////////////////////////////////////////
+void jsAxisFilter::set(unsigned int jsIdx, js::Axis axisIdx, const js::AxisFilter &filter)
+{
+    AxisState &axis = m_axes[jsIdx][axisIdx];
+    axis = AxisState();
+    axis.config = filter;
+
+    const auto bit = static_cast<unsigned char>(1u << axisIdx);
+
+    if ((filter.minCutoff > 0.f) || (filter.threshold > 0.f))
+        m_filteredAxes[jsIdx] |= bit;
+    else
+        m_filteredAxes[jsIdx] &= ~bit;
+
+    if (m_filteredAxes[jsIdx] != 0)
+        m_activeMask |= 1u << jsIdx;
+    else
+        m_activeMask &= ~(1u << jsIdx);
+}
+
+////////////////////////////////////////////////////////////
+void jsAxisFilter::reset(unsigned int jsIdx)
+{
+    for (AxisState &axis : m_axes[jsIdx])
+        axis.started = false;
+
+    m_settlingMask &= ~(1u << jsIdx);
+}
+
+////////////////////////////////////////////////////////////
+void jsAxisFilter::sample(AxisState &axis, float position, js::Event::Clock::time_point time)
+{
+    axis.input = position;
+
+    // the first sample and axes that are only thresholded are taken as they are
+    if (!axis.started || (axis.config.minCutoff <= 0.f))
+    {
+        axis.started = true;
+        axis.filtered = position;
+        axis.derivative = 0.f;
+        axis.time = time;
+        return;
+    }
+
+    float interval = std::chrono::duration<float>(time - axis.time).count();
+    if (interval < minInterval)
+        interval = minInterval;
+    else
+        axis.time = time;
+
+    // One-Euro filter: the cutoff frequency rises with the (smoothed) speed of the axis
+    const float speed = (position - axis.filtered) / interval;
+    axis.derivative += smoothing(derivativeCutoff, interval) * (speed - axis.derivative);
+
+    const float cutoff = axis.config.minCutoff + std::max(axis.config.beta, 0.f) * std::abs(axis.derivative);
+    axis.filtered += smoothing(cutoff, interval) * (position - axis.filtered);
+}
+
+////////////////////////////////////////////////////////////
+void jsAxisFilter::apply(unsigned int jsIdx, const js::axis_t (&reported)[js::max_nAxis],
+                         js::axis_t (&axes)[js::max_nAxis], std::vector<js::Event> &events, js::Event::Clock::time_point now)
+{
+    const unsigned int filtered = m_filteredAxes[jsIdx];
+    const bool settling = (m_settlingMask >> jsIdx) & 1u;
+    unsigned int sampled = 0;
+
+    // Feed the backend events of filtered axes in their order, they are replaced below
+    std::size_t kept = 0;
+    for (const js::Event &event : events)
+    {
+        if ((event.type == js::Event::AxisMoved) && (event.index < js::max_nAxis) && ((filtered >> event.index) & 1u))
+        {
+            AxisState &axis = m_axes[jsIdx][event.index];
+            axis.sequence = event.sequence;
+            sample(axis, js::axisToPercent(event.axisPosition), event.time);
+            sampled |= 1u << event.index;
+            continue;
+        }
+
+        events[kept++] = event;
+    }
+    events.resize(kept);
+
+    m_settlingMask &= ~(1u << jsIdx);
+
+    for (unsigned int remaining = filtered; remaining != 0; remaining &= remaining - 1)
+    {
+        const auto a = static_cast<unsigned int>(std::countr_zero(remaining));
+        AxisState &axis = m_axes[jsIdx][a];
+
+        // Without events: sample the backend position again while the filter moves towards it
+        const float input = js::axisToPercent(axes[a]);
+        if (!((sampled >> a) & 1u) && (settling || !axis.started || (input != axis.input)))
+        {
+            sample(axis, input, now);
+        }
+
+        // Report the filtered position only if it moved by the threshold
+        const js::axis_t filteredPosition = js::axisFromPercent(axis.filtered);
+        const float distance = std::abs(axis.filtered - js::axisToPercent(reported[a]));
+        js::axis_t position = reported[a];
+
+        if ((filteredPosition != reported[a]) && (distance >= axis.config.threshold))
+        {
+            position = filteredPosition;
+
+            js::Event event;
+            event.type = js::Event::AxisMoved;
+            event.joystick = static_cast<unsigned char>(jsIdx);
+            event.index = static_cast<unsigned char>(a);
+            event.axisPosition = position;
+            event.sequence = axis.sequence;
+            event.time = axis.time;
+            events.push_back(event);
+        }
+
+        axes[a] = position;
+
+        // The filter has not reached the backend position yet, and the rest is still to be reported
+        if ((axis.config.minCutoff > 0.f) &&
+            (std::abs(axis.input - js::axisToPercent(position)) >= std::max(axis.config.threshold, settledDistance)))
+            m_settlingMask |= 1u << jsIdx;
+    }
+}
+
+////////////////////////////////////////////////////////////
+float jsAxisConditioner::evaluate(const js::AxisResponse &response, float position)
+{
+    // deflection beyond the center deadzone, relative to the range up to the edge deadzone
+    const float deadzone = std::clamp(response.deadzone, 0.f, 100.f);
+    const float range = 100.f - std::clamp(response.edgeDeadzone, 0.f, 100.f) - deadzone;
+    const float deflection = std::abs(position) - deadzone;
+
+    if (deflection <= 0.f)
+        return 0.f;
+
+    const float t = (range > 0.f) ? std::min(deflection / range, 1.f) : 1.f;
+    const float k = std::max(response.curvature, 0.f);
+    float shaped = t;
+
+    switch (response.curve)
+    {
+    case js::AxisResponse::Exponential:
+        // flat center, steep towards the edges
+        if (k > 0.f)
+            shaped = std::expm1(k * t) / std::expm1(k);
+        break;
+
+    case js::AxisResponse::SCurve:
+        // flat center and flat edges, blended with linear
+        shaped = t + std::min(k, 1.f) * (t * t * (3.f - 2.f * t) - t);
+        break;
+
+    default:
+        break;
+    }
+
+    return std::copysign(shaped * std::clamp(response.saturation, 0.f, 100.f), position);
+}
+
+////////////////////////////////////////////////////////////
+void jsAxisConditioner::set(unsigned int jsIdx, js::Axis axisIdx, const js::AxisResponse &response)
+{
+    m_responses[jsIdx][axisIdx] = response;
+
+    const js::axis_t *table = nullptr;
+
+    if (response != js::AxisResponse())
+    {
+        // share the table with other axes of the same response, compute it otherwise
+        auto curve = std::find_if(m_curves.begin(), m_curves.end(), [&](const Curve &c) { return c.response == response; });
+
+        if (curve == m_curves.end())
+        {
+            auto values = std::make_unique<js::axis_t[]>(keyRange + 1);
+            for (unsigned int k = 0; k <= keyRange; ++k)
+                values[k] = js::axisFromPercent(evaluate(response, percentOfKey(k)));
+
+            curve = m_curves.insert(m_curves.end(), Curve{response, std::move(values)});
+        }
+
+        table = curve->table.get();
+    }
+
+    m_tables[jsIdx][axisIdx] = table;
+
+    // drop tables no axis uses any more, update the joysticks with conditioned axes
+    m_activeMask = 0;
+    std::erase_if(m_curves, [this](const Curve &c) {
+        for (const auto &tables : m_tables)
+        {
+            for (const js::axis_t *t : tables)
+            {
+                if (t == c.table.get())
+                    return false;
+            }
+        }
+        return true;
+    });
+
+    for (unsigned int i = 0; i < js::max_nJoystick; ++i)
+    {
+        for (const js::axis_t *t : m_tables[i])
+        {
+            if (t)
+                m_activeMask |= 1u << i;
+        }
+    }
+}
+
+} // namespace priv
+
+} // namespace hd
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+#ifndef DI8JOY_AXIS_HPP
+#define DI8JOY_AXIS_HPP
+
+// author: Daniel Hug, 2022
+
+// filtering and conditioning of axis positions
+//
+// jsAxisFilter smoothes the noise of an axis with an adaptive low pass (One-Euro
+// filter: strong smoothing at rest, little lag on fast moves) and reports a new
+// position only once it moved by a threshold. The backend events of a filtered
+// axis are replaced by one event per reported position, so a jittering axis at
+// rest produces no events and no state changes at all.
+//
+// jsAxisConditioner applies deadzones, saturation and a response curve.
+// The response of an axis is precomputed into a lookup table keyed by the axis
+// position quantized to 16 bit, so conditioning costs one table load per axis.
+// Axes with the same response share their table, axes without conditioning
+// (the default) have none and are left as delivered by the backend.
+//
+// Only the published state and the events are filtered and conditioned: the backends
+// keep working on the unfiltered positions, and recordings hold them as well.
+
+#include "di8joy.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace hd
+{
+
+namespace priv
+{
+
+class jsAxisFilter
+{
+  public:
+    void set(unsigned int jsIdx, js::Axis axisIdx, const js::AxisFilter &filter); // resets the axis
+
+    const js::AxisFilter &get(unsigned int jsIdx, js::Axis axisIdx) const { return m_axes[jsIdx][axisIdx].config; }
+
+    void reset(unsigned int jsIdx); // start the filters of joystick jsIdx from its next positions (after open)
+
+    bool any() const { return m_activeMask != 0; } // any axis of any joystick filtered
+
+    bool isActive(unsigned int jsIdx) const { return (m_activeMask >> jsIdx) & 1u; } // any axis of jsIdx filtered
+
+    std::uint32_t getSettlingMask() const { return m_settlingMask; } // bit i set: joystick i has a filtered axis that
+                                                                      // has not reached its position yet: update()
+                                                                      // has to apply() it without input
+
+    // Filter the axes of joystick jsIdx: axes are the positions of the backend on input and the positions to report
+    // on return, reported the positions reported last. The AxisMoved events of filtered axes are replaced by an
+    // event for each changed position to report.
+    void apply(unsigned int jsIdx, const js::axis_t (&reported)[js::max_nAxis], js::axis_t (&axes)[js::max_nAxis],
+               std::vector<js::Event> &events, js::Event::Clock::time_point now);
+
+  private:
+    struct AxisState
+    {
+        js::AxisFilter config;               // Filter settings
+        bool started{false};                 // The members below hold the last sample
+        float input{0.f};                    // Unfiltered position (percent) of the last sample
+        float filtered{0.f};                 // Filtered position (percent) of the last sample
+        float derivative{0.f};               // Filtered speed (percent per second) of the last sample
+        js::Event::Clock::time_point time{}; // Time of the last sample
+        std::uint32_t sequence{0};           // Sequence number of the last backend event
+    };
+
+    static void sample(AxisState &axis, float position, js::Event::Clock::time_point time);
+
+    AxisState m_axes[js::max_nJoystick][js::max_nAxis]{}; // Filter state of each axis
+    unsigned char m_filteredAxes[js::max_nJoystick]{};    // bit a set: axis a of the joystick is filtered
+    std::uint32_t m_activeMask = 0;                       // bit i set: joystick i has a filtered axis
+    std::uint32_t m_settlingMask = 0;                     // bit i set: joystick i has a settling axis
+};
+
+class jsAxisConditioner
+{
+  public:
+    static constexpr unsigned int keyRange = 65536; // table keys 0 ... keyRange for positions -100% ... 100%
+
+    // table key of an axis position
+    static unsigned int key(js::axis_t position)
+    {
+#if defined(DI8JOY_AXIS_INT16)
+        return static_cast<unsigned int>(position + 32768); // the raw value is the key
+#else
+        const float clamped = std::clamp(position, -100.f, 100.f);
+        return static_cast<unsigned int>((clamped + 100.f) * (keyRange / 200.f) + 0.5f);
+#endif
+    }
+
+    // axis position (percent) of a table key
+    static float percentOfKey(unsigned int key)
+    {
+#if defined(DI8JOY_AXIS_INT16)
+        return js::axisToPercent(static_cast<js::axis_t>(static_cast<int>(key) - 32768));
+#else
+        return static_cast<float>(key) * (200.f / keyRange) - 100.f;
+#endif
+    }
+
+    // conditioned axis position (percent) as computed for the tables
+    static float evaluate(const js::AxisResponse &response, float position);
+
+    void set(unsigned int jsIdx, js::Axis axisIdx, const js::AxisResponse &response);
+
+    const js::AxisResponse &get(unsigned int jsIdx, js::Axis axisIdx) const { return m_responses[jsIdx][axisIdx]; }
+
+    bool isActive(unsigned int jsIdx) const { return (m_activeMask >> jsIdx) & 1u; } // any axis of jsIdx conditioned
+
+    // condition all axes of joystick jsIdx in place
+    void apply(unsigned int jsIdx, js::axis_t (&axes)[js::max_nAxis]) const
+    {
+        const auto &tables = m_tables[jsIdx];
+
+        for (unsigned int i = 0; i < js::max_nAxis; ++i)
+        {
+            if (tables[i])
+                axes[i] = tables[i][key(axes[i])];
+        }
+    }
+
+    js::axis_t apply(unsigned int jsIdx, unsigned int axisIdx, js::axis_t position) const
+    {
+        const js::axis_t *table = m_tables[jsIdx][axisIdx];
+        return table ? table[key(position)] : position;
+    }
+
+  private:
+    struct Curve
+    {
+        js::AxisResponse response;           // Response the table was computed for
+        std::unique_ptr<js::axis_t[]> table; // Conditioned position of each key (keyRange + 1 entries)
+    };
+
+    std::vector<Curve> m_curves;                                      // Tables in use
+    js::AxisResponse m_responses[js::max_nJoystick][js::max_nAxis]{}; // Response of each axis
+    const js::axis_t *m_tables[js::max_nJoystick][js::max_nAxis]{};   // Table of each axis, nullptr if not conditioned
+    std::uint32_t m_activeMask = 0;                                   // bit i set: joystick i has a conditioned axis
+};
+
+} // namespace priv
+
+} // namespace hd
+
+#endif // DI8JOY_AXIS_HPP
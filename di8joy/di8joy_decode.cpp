@@ -0,0 +1,303 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+// implements the decoding of buffered DirectInput events of the di8joy library
+
+#include "di8joy_decode.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// anonymous namespace for things to be kept private to this translation unit
+
+// pov direction (position in hundredths of a degree / 45 degrees, rounded) -> virtual button,
+// each direction covers +/-22.5 degrees around its angle
+constexpr hd::js::PovButton povButtons[8] = {hd::js::PovU, hd::js::PovUR, hd::js::PovR, hd::js::PovDR,
+                                             hd::js::PovD, hd::js::PovDL, hd::js::PovL, hd::js::PovUL};
+
+} // anonymous namespace
+
+namespace hd
+{
+
+namespace priv
+{
+
+////////////////////////////////////////////////////////////
+void jsDecodeTable::build(const int (&axes)[js::max_nAxis], const int (&povs)[js::max_nPOV], const int (&buttons)[js::max_nButton])
+{
+    for (jsControl &control : m_controls)
+        control = jsControl{};
+
+    auto assign = [this](int offset, jsControl::Kind kind, int index) {
+        if ((offset >= 0) && (offset < size))
+            m_controls[offset] = jsControl{kind, static_cast<unsigned char>(index)};
+    };
+
+    for (int i = 0; i < js::max_nAxis; ++i)
+        assign(axes[i], jsControl::Axis, i);
+
+    for (int i = 0; i < js::max_nButton; ++i)
+        assign(buttons[i], jsControl::Button, i);
+
+    for (int i = 0; i < js::max_nPOV; ++i)
+        assign(povs[i], jsControl::Pov, i);
+}
+
+////////////////////////////////////////////////////////////
+jsControl jsDecodeTable::decode(jsState &state, unsigned int offset, unsigned int data) const
+{
+    const jsControl control = lookup(offset);
+    bool changed = false;
+
+    switch (control.kind)
+    {
+    case jsControl::Axis:
+    {
+        // map axis range to +/-100% of full scale in each direction
+        const js::axis_t position = axisFromRaw16(static_cast<std::int16_t>(data));
+        changed = (state.axes[control.index] != position);
+        state.axes[control.index] = position;
+    }
+    break;
+
+    case jsControl::Button:
+        changed = (state.buttons.test(control.index) != (data != 0));
+        state.buttons.set(control.index, data != 0);
+        break;
+
+    case jsControl::Pov:
+    {
+        unsigned short value = static_cast<unsigned short>(data & 0xFFFF);
+
+        // angles (in hundredths of a degree), -1 indicates center position
+        int position = (value != 0xFFFF) ? static_cast<int>(value) : -1;
+        changed = (state.povs[control.index] != position);
+        state.povs[control.index] = position;
+    }
+    break;
+
+    case jsControl::None:
+        break;
+    }
+
+    return changed ? control : jsControl{};
+}
+
+////////////////////////////////////////////////////////////
+void jsDecodeTable::decodeSnapshot(jsState &state, const void *joystate) const
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(joystate);
+
+    for (unsigned int offset = 0; offset < size; ++offset)
+    {
+        const jsControl control = m_controls[offset];
+
+        switch (control.kind)
+        {
+        case jsControl::Axis:
+        case jsControl::Pov:
+        {
+            // axes (LONG) and povs (DWORD) are 4 bytes wide
+            unsigned int data;
+            std::memcpy(&data, bytes + offset, sizeof(data));
+            decode(state, offset, data);
+        }
+        break;
+
+        case jsControl::Button:
+            state.buttons.set(control.index, (bytes[offset] & 0x80) != 0);
+            break;
+
+        case jsControl::None:
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+js::Event makeEvent(const jsState &state, jsControl control, js::Event::Clock::time_point time, std::uint32_t sequence)
+{
+    js::Event event;
+    event.index = control.index;
+    event.sequence = sequence;
+    event.time = time;
+
+    switch (control.kind)
+    {
+    case jsControl::Axis:
+        event.type = js::Event::AxisMoved;
+        event.axisPosition = state.axes[control.index];
+        break;
+
+    case jsControl::Pov:
+        event.type = js::Event::PovMoved;
+        event.position = state.povs[control.index];
+        break;
+
+    case jsControl::Button:
+    case jsControl::None:
+        event.type = state.buttons.test(control.index) ? js::Event::ButtonPressed : js::Event::ButtonReleased;
+        break;
+    }
+
+    return event;
+}
+
+////////////////////////////////////////////////////////////
+void appendChangeEvents(std::vector<js::Event> &events, const jsState &before, const jsState &after,
+                        js::Event::Clock::time_point time, std::uint32_t sequence)
+{
+    for (unsigned int i = 0; i < js::max_nAxis; ++i)
+    {
+        if (before.axes[i] != after.axes[i])
+            events.push_back(makeEvent(after, jsControl{jsControl::Axis, static_cast<unsigned char>(i)}, time, sequence));
+    }
+
+    (before.buttons ^ after.buttons).forEach([&](unsigned int buttonIdx) {
+        events.push_back(makeEvent(after, jsControl{jsControl::Button, static_cast<unsigned char>(buttonIdx)}, time, sequence));
+    });
+
+    for (unsigned int i = 0; i < js::max_nPOV; ++i)
+    {
+        if (before.povs[i] != after.povs[i])
+            events.push_back(makeEvent(after, jsControl{jsControl::Pov, static_cast<unsigned char>(i)}, time, sequence));
+    }
+}
+
+////////////////////////////////////////////////////////////
+js::PovButton povButton(int position)
+{
+    if ((position < 0) || (position >= 36000))
+        return js::PovC;
+
+    return povButtons[((position + 2250) / 4500) % 8];
+}
+
+////////////////////////////////////////////////////////////
+void applyPovButtons(jsState &state, const jsState &before, const jsCaps &caps, std::vector<js::Event> &events)
+{
+    // virtual button pressed before for each hat, nPovButton if none (just opened)
+    unsigned int positions[js::max_nPOV];
+
+    unsigned int nHat = 0;
+    for (; (nHat < caps.nPOV) && hasPovButtons(caps, nHat); ++nHat)
+    {
+        const unsigned int base = povButtonBase(caps, nHat);
+
+        positions[nHat] = js::nPovButton;
+        for (unsigned int button = 0; button < js::nPovButton; ++button)
+        {
+            if (before.buttons.test(base + button))
+                positions[nHat] = button;
+        }
+
+        const js::PovButton position = povButton(state.povs[nHat]);
+        for (unsigned int button = 0; button < js::nPovButton; ++button)
+            state.buttons.set(base + button, button == position);
+    }
+
+    if (nHat == 0)
+        return;
+
+    // the events of the virtual buttons follow those of the pov hats
+    auto move = [&](js::Event event, unsigned int hat, unsigned int position) {
+        event.position = 0;
+
+        if (positions[hat] < js::nPovButton)
+        {
+            event.type = js::Event::ButtonReleased;
+            event.index = static_cast<unsigned char>(povButtonBase(caps, hat) + positions[hat]);
+            events.push_back(event);
+        }
+
+        event.type = js::Event::ButtonPressed;
+        event.index = static_cast<unsigned char>(povButtonBase(caps, hat) + position);
+        events.push_back(event);
+
+        positions[hat] = position;
+    };
+
+    const std::size_t count = events.size();
+    js::Event last;
+    last.time = js::Event::Clock::now();
+
+    for (std::size_t e = 0; e < count; ++e)
+    {
+        last = events[e];
+
+        if ((last.type != js::Event::PovMoved) || (last.index >= nHat))
+            continue;
+
+        const js::PovButton position = povButton(last.position);
+
+        if (position != positions[last.index])
+            move(last, last.index, position);
+    }
+
+    // hats without events (just opened): take the time and sequence of the last event
+    for (unsigned int i = 0; i < nHat; ++i)
+    {
+        const js::PovButton position = povButton(state.povs[i]);
+
+        if (position != positions[i])
+            move(last, i, position);
+    }
+}
+
+////////////////////////////////////////////////////////////
+unsigned int adaptEventBufferSize(unsigned int current, unsigned int burst, bool overflow)
+{
+    if (current >= max_eventBufferSize)
+        return 0;
+
+    if (!overflow && (2 * burst <= current))
+        return 0;
+
+    // at least double, and leave room for twice the observed burst
+    unsigned int size = std::max<unsigned int>(current, min_eventBufferSize);
+    while ((size < 2 * current) || (size < 2 * burst))
+        size *= 2;
+
+    return std::min<unsigned int>(size, max_eventBufferSize);
+}
+
+} // namespace priv
+
+} // namespace hd
@@ -0,0 +1,164 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+#ifndef DI8JOY_DECODE_HPP
+#define DI8JOY_DECODE_HPP
+
+// author: Daniel Hug, 2022
+
+// decoding of buffered DirectInput events (DIDEVICEOBJECTDATA) into a jsState
+//
+// A buffered event identifies its control only by the offset (dwOfs) of that
+// control in DIJOYSTATE2. jsDecodeTable is built once when a device is opened and
+// maps every possible offset directly to the control, so decoding an event costs
+// one table load instead of a search through the axis, button and pov offsets.
+//
+// The same table decodes a complete DIJOYSTATE2 snapshot, which is what polled
+// devices deliver and what a buffered device is resynchronized from after its
+// event buffer overflowed.
+//
+// The event helpers below are shared by all backends.
+//
+// This unit does not depend on windows.h to be usable (and measurable) on every platform.
+
+#include "di8joy.hpp"
+#include "di8joy_state.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace hd
+{
+
+namespace priv
+{
+
+struct jsControl
+{
+    enum Kind : unsigned char
+    {
+        None,   // offset does not belong to a mapped control
+        Axis,   // index: js::Axis
+        Button, // index: button number
+        Pov     // index: pov hat number
+    };
+
+    Kind kind{None};
+    unsigned char index{0};
+};
+
+class jsDecodeTable
+{
+  public:
+    enum
+    {
+        size = 272 // sizeof(DIJOYSTATE2): every offset a DirectInput event can refer to
+    };
+
+    // Build the table from the offsets found during object enumeration (-1 if not available)
+    void build(const int (&axes)[js::max_nAxis], const int (&povs)[js::max_nPOV], const int (&buttons)[js::max_nButton]);
+
+    jsControl lookup(unsigned int offset) const
+    {
+        return (offset < size) ? m_controls[offset] : jsControl{};
+    }
+
+    // Apply a single buffered event (offset and data as in DIDEVICEOBJECTDATA) to state,
+    // returns the control changed by it (kind None if the event did not change state)
+    jsControl decode(jsState &state, unsigned int offset, unsigned int data) const;
+
+    // Overwrite all mapped controls of state from a complete snapshot (DIJOYSTATE2, size bytes)
+    void decodeSnapshot(jsState &state, const void *joystate) const;
+
+  private:
+    jsControl m_controls[size];
+};
+
+// Event for a control of state that has just been changed
+js::Event makeEvent(const jsState &state, jsControl control, js::Event::Clock::time_point time, std::uint32_t sequence);
+
+// Append events for all axes, buttons and povs that differ between before and after,
+// for changes without device events (snapshots of polled devices or after a resync)
+void appendChangeEvents(std::vector<js::Event> &events, const jsState &before, const jsState &after,
+                        js::Event::Clock::time_point time, std::uint32_t sequence);
+
+// Overwrite the buttons of state that are mapped to a control of the device (codes[i] != -1) by pressed(codes[i]),
+// for snapshots of all keys: unmapped buttons keep their state, like the virtual pov buttons (as decodeSnapshot())
+template <typename Pressed>
+void setMappedButtons(jsState &state, const int (&codes)[js::max_nButton], Pressed pressed)
+{
+    for (unsigned int i = 0; i < js::max_nButton; ++i)
+    {
+        if (codes[i] != -1)
+            state.buttons.set(i, pressed(codes[i]));
+    }
+}
+
+// Virtual buttons of the pov hats (js::PovButton): the buttons of hat povIdx follow the physical
+// buttons, hats whose buttons do not fit below js::max_nButton have none
+inline unsigned int povButtonBase(const jsCaps &caps, unsigned int povIdx)
+{
+    return caps.nButton + povIdx * js::nPovButton;
+}
+
+inline bool hasPovButtons(const jsCaps &caps, unsigned int povIdx)
+{
+    return (povIdx < caps.nPOV) && (povButtonBase(caps, povIdx + 1) <= js::max_nButton);
+}
+
+// Virtual button of a pov position (hundredths of a degree, -1 centered), one table load
+js::PovButton povButton(int position);
+
+// Set the virtual buttons of all pov hats of state, and append a release and a press event
+// for each pov event in events that moved its hat to another virtual button
+void applyPovButtons(jsState &state, const jsState &before, const jsCaps &caps, std::vector<js::Event> &events);
+
+// Event buffer sizes of buffered devices: start with the minimum and grow up to the maximum
+enum
+{
+    min_eventBufferSize = 32,
+    max_eventBufferSize = 1024
+};
+
+// Buffer size to use after draining burst events at the current size (0 if it can stay as is):
+// grow on overflow or when a burst filled more than half of the buffer
+unsigned int adaptEventBufferSize(unsigned int current, unsigned int burst, bool overflow);
+
+} // namespace priv
+
+} // namespace hd
+
+#endif // DI8JOY_DECODE_HPP
@@ -35,20 +35,32 @@
 ////////////////////////////////////////////////////////////
 
 // implements the the direct input 8 backend services of the di8joy library
+// (the evdev backend for Linux lives in di8joy_impl_evdev.cpp,
+// the replay backend for all platforms in di8joy_impl_replay.cpp)
 
 #include "di8joy_impl.hpp"
 
 // all the stuff for err()
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <iostream>
+#include <iterator>
 #include <streambuf>
 #include <vector>
 
+#if defined(_WIN32)
+
 ////////////////////////////////////////////////////////////
 // DirectInput
 ////////////////////////////////////////////////////////////
 
+#include <dbt.h>
+
+#include <future>
+#include <mutex>
+#include <thread>
+
 #ifndef DIDFT_OPTIONAL
 #define DIDFT_OPTIONAL 0x80000000
 #endif
@@ -71,6 +83,8 @@ const GUID GUID_RzAxis = {0xa36d02e3, 0xc9f3, 0x11cf, {0xbf, 0xc7, 0x44, 0x45, 0
 const GUID GUID_Slider = {0xa36d02e4, 0xc9f3, 0x11cf, {0xbf, 0xc7, 0x44, 0x45, 0x53, 0x54, 0x00, 0x00}};
 const GUID GUID_POV = {0xa36d02f2, 0xc9f3, 0x11cf, {0xbf, 0xc7, 0x44, 0x45, 0x53, 0x54, 0x00, 0x00}};
 
+const GUID GUID_DEVINTERFACE_HID = {0x4d1e55b2, 0xf16f, 0x11cf, {0x88, 0xcb, 0x00, 0x11, 0x11, 0x00, 0x00, 0x30}};
+
 } // namespace guids
 
 HMODULE dinput8dll = nullptr;
@@ -85,17 +99,41 @@ struct jsRecord
 
 using JoystickList = std::vector<jsRecord>;
 JoystickList jsList;
+std::uint32_t connectedMask = 0; // bit i set: a device with index i is in jsList
+
+std::thread watcherThread;    // hotplug watcher (message loop of a message-only window)
+DWORD watcherThreadId = 0;    // id of the watcher thread, target of WM_QUIT
+HANDLE hotplugEvent = nullptr; // signaled by the watcher, wakes up waitForInput()
+
+// set by open() which may run on a worker thread
+std::atomic<HANDLE> deviceEvents[hd::js::max_nJoystick]{}; // input notification event of each open joystick, nullptr if none
+std::atomic<unsigned int> polledMask{0};                   // bit i set: joystick i is open but must be polled for input
+
+// wait interval of waitForInput() while a joystick without input notification is open
+const DWORD polledDeviceInterval = 10;
 
-struct jsBlacklistEntry
+const DWORD directInputEventChunkSize = 64; // events fetched per GetDeviceData() call
+
+static_assert(sizeof(DIJOYSTATE2) == hd::priv::jsDecodeTable::size, "decode table must cover DIJOYSTATE2");
+
+LRESULT CALLBACK hotplugWindowProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam)
 {
-    unsigned int vendorId;
-    unsigned int productId;
-};
+    // a HID device interface arrived or was removed, the update thread rescans
+    if (message == WM_DEVICECHANGE && (wParam == DBT_DEVICEARRIVAL || wParam == DBT_DEVICEREMOVECOMPLETE))
+    {
+        hd::priv::jsImpl::notifyConnectionsChanged();
+        SetEvent(hotplugEvent);
+    }
 
-using JoystickBlacklist = std::vector<jsBlacklistEntry>;
-JoystickBlacklist jsBlacklist;
+    return DefWindowProcW(window, message, wParam, lParam);
+}
 
-const DWORD directInputEventBufferSize = 32;
+} // anonymous namespace
+
+#endif // _WIN32
+
+namespace
+{
 
 // This class will be used as the default streambuf of hd::Err,
 // it outputs to stderr by default (to keep the default behavior)
@@ -157,6 +195,29 @@ class DefaultErrStreamBuf : public std::streambuf
     }
 };
 
+// backend of the joysticks opened from now on
+hd::priv::jsBackend backend = hd::priv::jsBackend::Platform;
+
+// connection handling, common to all backends
+std::atomic<bool> connectionsChanged{true}; // set by the hotplug watcher, cleared by updateConnections()
+bool lazyUpdates = false;                   // rescan only on hotplug notifications
+bool watcherRunning = false;                // hotplug watcher thread started successfully
+std::chrono::steady_clock::time_point lastScan;
+
+// rescan interval if lazy updates are requested but no hotplug watcher is available
+constexpr std::chrono::seconds fallbackScanInterval{1};
+
+// capability profiles of the devices of the platform backend: their backend objects are offsets
+// into DIJOYSTATE2 (axes and povs are 4 bytes wide there), or evdev event codes and hat numbers
+#if defined(_WIN32)
+hd::priv::jsProfileCache profiles({hd::priv::jsDecodeTable::size - 3, hd::priv::jsDecodeTable::size - 3,
+                                   hd::priv::jsDecodeTable::size});
+#elif defined(__linux__)
+hd::priv::jsProfileCache profiles({ABS_CNT, (ABS_HAT3Y - ABS_HAT0X) / 2 + 1, KEY_CNT});
+#else
+hd::priv::jsProfileCache profiles({0, 0, 0});
+#endif
+
 } // anonymous namespace
 
 namespace hd
@@ -175,46 +236,266 @@ namespace priv
 ////////////////////////////////////////////////////////////
 void jsImpl::initialize()
 {
+#if defined(_WIN32)
     // Try to initialize DirectInput
     initializeDInput();
 
     if (!directInput)
         err() << "DirectInput not available" << std::endl;
 
-    // Perform the initial scan and populate the connection cache
-    updateConnectionsDInput();
+#elif defined(__linux__)
+    initializeEvdev();
+#endif
+
+    // Start watching for hotplug events before the initial scan, so no device is missed
+    // (the first update() performs the initial scan)
+    setLazyUpdates(true);
 }
 
 ////////////////////////////////////////////////////////////
 void jsImpl::cleanup()
 {
+    setLazyUpdates(false);
+
+#if defined(_WIN32)
     // Clean up DirectInput
     cleanupDInput();
+#elif defined(__linux__)
+    cleanupEvdev();
+#endif
+}
+
+////////////////////////////////////////////////////////////
+jsBackend jsImpl::getBackend()
+{
+    return backend;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::setBackend(jsBackend newBackend)
+{
+    backend = newBackend;
+
+    // the joysticks of the new backend have to be enumerated
+    notifyConnectionsChanged();
 }
 
 ////////////////////////////////////////////////////////////
 bool jsImpl::isConnected(unsigned int index)
 {
-    return isConnectedDInput(index);
+    return (getConnectedMask() >> index) & 1u;
+}
+
+////////////////////////////////////////////////////////////
+std::uint32_t jsImpl::getConnectedMask()
+{
+    switch (backend)
+    {
+    case jsBackend::Replay:
+        return connectedMaskReplay();
+    case jsBackend::Synthetic:
+        return connectedMaskSynthetic();
+    case jsBackend::Platform:
+        break;
+    }
+
+#if defined(_WIN32)
+    return connectedMaskDInput();
+#elif defined(__linux__)
+    return connectedMaskEvdev();
+#endif
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::setLazyUpdates(bool status)
+{
+    lazyUpdates = status;
+
+    if (lazyUpdates && !watcherRunning)
+    {
+#if defined(_WIN32)
+        watcherRunning = startHotplugWatcherDInput();
+#elif defined(__linux__)
+        watcherRunning = startHotplugWatcherEvdev();
+#endif
+        if (!watcherRunning)
+            err() << "Hotplug notifications not available, rescanning joysticks periodically" << std::endl;
+    }
+    else if (!lazyUpdates && watcherRunning)
+    {
+#if defined(_WIN32)
+        stopHotplugWatcherDInput();
+#elif defined(__linux__)
+        stopHotplugWatcherEvdev();
+#endif
+        watcherRunning = false;
+    }
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::hasConnectionChanges()
+{
+    // replay and synthetic joysticks connect and disconnect by themselves
+    if (backend != jsBackend::Platform)
+        return connectionsChanged.load(std::memory_order_acquire);
+
+    if (!lazyUpdates)
+        return true;
+
+    if (!watcherRunning)
+        return std::chrono::steady_clock::now() - lastScan >= fallbackScanInterval;
+
+    return connectionsChanged.load(std::memory_order_acquire);
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::updateConnections()
+{
+    // Clear the flag before scanning: a notification arriving during the scan triggers another one
+    connectionsChanged.exchange(false, std::memory_order_acq_rel);
+    lastScan = std::chrono::steady_clock::now();
+
+    if (backend != jsBackend::Platform)
+        return;
+
+#if defined(_WIN32)
+    updateConnectionsDInput();
+#elif defined(__linux__)
+    updateConnectionsEvdev();
+#endif
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::notifyConnectionsChanged()
+{
+    connectionsChanged.store(true, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::setProfileFile(const std::string &path)
+{
+    return profiles.setFile(path);
+}
+
+////////////////////////////////////////////////////////////
+jsProfileCache &jsImpl::getProfiles()
+{
+    return profiles;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::waitForInput(std::chrono::milliseconds timeout)
+{
+    if (hasConnectionChanges())
+        return true;
+
+    switch (backend)
+    {
+    case jsBackend::Replay:
+        return waitForInputReplay(timeout);
+    case jsBackend::Synthetic:
+        return waitForInputSynthetic(timeout);
+    case jsBackend::Platform:
+        break;
+    }
+
+    // Without hotplug notifications wake up in time for the periodic rescan
+    if (lazyUpdates && !watcherRunning)
+    {
+        auto untilScan = std::chrono::duration_cast<std::chrono::milliseconds>(lastScan + fallbackScanInterval - std::chrono::steady_clock::now());
+        timeout = std::clamp(untilScan, std::chrono::milliseconds(0), timeout);
+    }
+
+#if defined(_WIN32)
+    return waitForInputDInput(static_cast<DWORD>(timeout.count()));
+#elif defined(__linux__)
+    return waitForInputEvdev(static_cast<int>(timeout.count()));
+#endif
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::prepareUpdate()
+{
+    switch (backend)
+    {
+    case jsBackend::Replay:
+        prepareUpdateReplay();
+        return;
+    case jsBackend::Synthetic:
+        prepareUpdateSynthetic();
+        return;
+    case jsBackend::Platform:
+        break;
+    }
+
+#if defined(__linux__)
+    prepareUpdateEvdev();
+#endif
 }
 
 ////////////////////////////////////////////////////////////
 bool jsImpl::open(unsigned int index)
 {
+    m_backend = backend;
+
+    switch (backend)
+    {
+    case jsBackend::Replay:
+        return openReplay(index);
+    case jsBackend::Synthetic:
+        return openSynthetic(index);
+    case jsBackend::Platform:
+        break;
+    }
+
+#if defined(_WIN32)
     return openDInput(index);
+#elif defined(__linux__)
+    return openEvdev(index);
+#endif
 }
 
 ////////////////////////////////////////////////////////////
 void jsImpl::close()
 {
+    switch (m_backend)
+    {
+    case jsBackend::Replay:
+        closeReplay();
+        return;
+    case jsBackend::Synthetic:
+        closeSynthetic();
+        return;
+    case jsBackend::Platform:
+        break;
+    }
+
+#if defined(_WIN32)
     if (directInput)
         closeDInput();
+#elif defined(__linux__)
+    closeEvdev();
+#endif
 }
 
 ////////////////////////////////////////////////////////////
 jsCaps jsImpl::getCapabilities() const
 {
+    switch (m_backend)
+    {
+    case jsBackend::Replay:
+        return getCapabilitiesReplay();
+    case jsBackend::Synthetic:
+        return getCapabilitiesSynthetic();
+    case jsBackend::Platform:
+        break;
+    }
+
+#if defined(_WIN32)
     return getCapabilitiesDInput();
+#elif defined(__linux__)
+    return getCapabilitiesEvdev();
+#endif
 }
 
 ////////////////////////////////////////////////////////////
@@ -224,22 +505,62 @@ js::Id jsImpl::getId() const
 }
 
 ////////////////////////////////////////////////////////////
-jsState jsImpl::update()
+unsigned int jsImpl::getOverflowCount() const
+{
+    return m_overflowCount;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::update(jsState &state, const jsState &current, std::vector<js::Event> &events)
 {
+    const std::size_t firstEvent = events.size();
 
-    if (m_buffered)
+    bool written;
+
+    switch (m_backend)
     {
-        return updateDInputBuffered();
+    case jsBackend::Replay:
+        written = updateReplay(state, current, events);
+        break;
+    case jsBackend::Synthetic:
+        written = updateSynthetic(state, current, events);
+        break;
+    case jsBackend::Platform:
+    default:
+#if defined(_WIN32)
+        written = m_buffered ? updateDInputBuffered(state, current, events) : updateDInputPolled(state, current, events);
+#elif defined(__linux__)
+        written = updateEvdev(state, current, events);
+#endif
+        break;
     }
-    else
+
+    if (written && !state.connected)
     {
-        return updateDInputPolled();
+        // A disconnected joystick releases all buttons that are still held
+        jsState held = current;
+        for (std::size_t i = firstEvent; i < events.size(); ++i)
+        {
+            if ((events[i].type == js::Event::ButtonPressed) || (events[i].type == js::Event::ButtonReleased))
+                held.buttons.set(events[i].index, events[i].type == js::Event::ButtonPressed);
+        }
+
+        jsState released = held;
+        released.buttons = js::ButtonMask();
+        appendChangeEvents(events, held, released, js::Event::Clock::now(), ++m_sequence);
     }
+
+    return written;
 }
 
+#if defined(_WIN32)
+
 ////////////////////////////////////////////////////////////
 void jsImpl::initializeDInput()
 {
+    // Auto-reset event set by the hotplug watcher
+    hotplugEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+
     // Try to load dinput8.dll
     dinput8dll = LoadLibraryA("dinput8.dll");
 
@@ -286,24 +607,26 @@ void jsImpl::cleanupDInput()
     // Unload dinput8.dll
     if (dinput8dll)
         FreeLibrary(dinput8dll);
-}
 
-////////////////////////////////////////////////////////////
-bool jsImpl::isConnectedDInput(unsigned int index)
-{
-    // Check if a joystick with the given index is in the connected list
-    for (const jsRecord &record : jsList)
+    if (hotplugEvent)
     {
-        if (record.index == index)
-            return true;
+        CloseHandle(hotplugEvent);
+        hotplugEvent = nullptr;
     }
+}
 
-    return false;
+////////////////////////////////////////////////////////////
+std::uint32_t jsImpl::connectedMaskDInput()
+{
+    return connectedMask;
 }
 
 ////////////////////////////////////////////////////////////
 void jsImpl::updateConnectionsDInput()
 {
+    if (!directInput)
+        return;
+
     // Clear plugged flags so we can determine which devices were added/removed
     for (jsRecord &record : jsList)
         record.plugged = false;
@@ -311,43 +634,112 @@ void jsImpl::updateConnectionsDInput()
     // Enumerate devices
     HRESULT result = directInput->EnumDevices(DI8DEVCLASS_GAMECTRL, &jsImpl::deviceEnumerationCallback, nullptr, DIEDFL_ATTACHEDONLY);
 
-    // Remove devices that were not connected during the enumeration
+    // Remove devices that were not connected during the enumeration,
+    // the indices of the remaining ones make up the connected-slot mask
+    connectedMask = 0;
     for (auto i = jsList.begin(); i != jsList.end();)
     {
         if (!i->plugged)
+        {
             i = jsList.erase(i);
+        }
         else
+        {
+            if (i->index < js::max_nJoystick)
+                connectedMask |= 1u << i->index;
             ++i;
+        }
     }
 
     if (FAILED(result))
     {
         err() << "Failed to enumerate DirectInput devices: " << result << std::endl;
-
-        return;
     }
-
-    // Assign unused joystick indices to devices that were newly connected
-    for (unsigned int i = 0; i < js::max_nJoystick; ++i)
+    else
     {
+        // Assign the lowest unused joystick indices to devices that were newly connected
         for (jsRecord &record : jsList)
         {
-            if (record.index == i)
-                break;
-
-            if (record.index == js::max_nJoystick)
+            if ((record.index == js::max_nJoystick) && (connectedMask != allJoysticksMask))
             {
-                record.index = i;
-                break;
+                record.index = static_cast<unsigned int>(std::countr_one(connectedMask));
+                connectedMask |= 1u << record.index;
             }
         }
     }
 }
 
+////////////////////////////////////////////////////////////
+bool jsImpl::startHotplugWatcherDInput()
+{
+    std::promise<bool> started;
+    std::future<bool> result = started.get_future();
+
+    watcherThread = std::thread([&started] {
+        HINSTANCE instance = GetModuleHandleW(nullptr);
+
+        WNDCLASSW windowClass{};
+        windowClass.lpfnWndProc = hotplugWindowProc;
+        windowClass.hInstance = instance;
+        windowClass.lpszClassName = L"di8joy_hotplug";
+        RegisterClassW(&windowClass);
+
+        // message-only windows receive device notifications, but are never shown
+        HWND window = CreateWindowExW(0, windowClass.lpszClassName, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, instance, nullptr);
+        HDEVNOTIFY notification = nullptr;
+
+        if (window)
+        {
+            DEV_BROADCAST_DEVICEINTERFACE_W filter{};
+            filter.dbcc_size = sizeof(filter);
+            filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+            filter.dbcc_classguid = guids::GUID_DEVINTERFACE_HID;
+
+            notification = RegisterDeviceNotificationW(window, &filter, DEVICE_NOTIFY_WINDOW_HANDLE);
+        }
+
+        // the message queue exists now (created with the window), WM_QUIT can be posted to it
+        watcherThreadId = GetCurrentThreadId();
+        started.set_value(notification != nullptr);
+
+        if (notification)
+        {
+            MSG message;
+            while (GetMessageW(&message, nullptr, 0, 0) > 0)
+                DispatchMessageW(&message);
+
+            UnregisterDeviceNotification(notification);
+        }
+
+        if (window)
+            DestroyWindow(window);
+
+        UnregisterClassW(windowClass.lpszClassName, instance);
+    });
+
+    if (!result.get())
+    {
+        watcherThread.join();
+        err() << "Failed to register for device notifications" << std::endl;
+
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::stopHotplugWatcherDInput()
+{
+    PostThreadMessageW(watcherThreadId, WM_QUIT, 0, 0);
+    watcherThread.join();
+}
+
 ////////////////////////////////////////////////////////////
 bool jsImpl::openDInput(unsigned int index)
 {
     // Initialize DirectInput members
+    m_index = index;
     m_device = nullptr;
 
     for (int &axis : m_axes)
@@ -361,8 +753,11 @@ bool jsImpl::openDInput(unsigned int index)
 
     std::memset(&m_deviceCaps, 0, sizeof(DIDEVCAPS));
     m_deviceCaps.dwSize = sizeof(DIDEVCAPS);
-    m_state = jsState();
+    m_resync = true;
     m_buffered = false;
+    m_bufferSize = 0;
+    m_event = nullptr;
+    m_overflowCount = 0;
 
     // Search for a joystick with the given index in the connected list
     for (const jsRecord &record : jsList)
@@ -390,23 +785,6 @@ bool jsImpl::openDInput(unsigned int index)
             {
                 m_identification.productId = HIWORD(property.dwData);
                 m_identification.vendorId = LOWORD(property.dwData);
-
-                // Check if device is already blacklisted
-                if (m_identification.productId && m_identification.vendorId)
-                {
-                    for (const jsBlacklistEntry &blacklistEntry : jsBlacklist)
-                    {
-                        if ((m_identification.productId == blacklistEntry.productId) &&
-                            (m_identification.vendorId == blacklistEntry.vendorId))
-                        {
-                            // Device is blacklisted
-                            m_device->Release();
-                            m_device = nullptr;
-
-                            return false;
-                        }
-                    }
-                }
             }
 
             // Get friendly product name of the device
@@ -420,11 +798,24 @@ bool jsImpl::openDInput(unsigned int index)
             if (SUCCEEDED(m_device->GetProperty(DIPROP_PRODUCTNAME, &stringProperty.diph)))
                 m_identification.name = stringProperty.wsz;
 
-            static bool formatInitialized = false;
-            static DIDATAFORMAT format;
+            // A device seen before is opened from its profile, a device found unusable before is refused
+            const std::uint32_t nameHash = jsProfileCache::hash(m_identification.name);
+            jsProfile profile;
+            const bool known = getProfiles().find(m_identification.vendorId, m_identification.productId, nameHash, profile);
 
-            if (!formatInitialized)
+            if (known && (profile.flags & jsProfile::Rejected))
             {
+                m_device->Release();
+                m_device = nullptr;
+
+                return false;
+            }
+
+            // the data format is shared by all devices, which may be opened concurrently
+            static std::once_flag formatInitialized;
+            static DIDATAFORMAT format;
+
+            std::call_once(formatInitialized, [] {
                 const DWORD axisType = DIDFT_AXIS | DIDFT_OPTIONAL | DIDFT_ANYINSTANCE;
                 const DWORD povType = DIDFT_POV | DIDFT_OPTIONAL | DIDFT_ANYINSTANCE;
                 const DWORD buttonType = DIDFT_BUTTON | DIDFT_OPTIONAL | DIDFT_ANYINSTANCE;
@@ -504,9 +895,7 @@ bool jsImpl::openDInput(unsigned int index)
                 format.dwDataSize = sizeof(DIJOYSTATE2);
                 format.dwNumObjs = 8 * 4 + 4 + hd::js::max_nButton;
                 format.rgodf = data;
-
-                formatInitialized = true;
-            }
+            });
 
             // Set device data format
             result = m_device->SetDataFormat(&format);
@@ -521,39 +910,68 @@ bool jsImpl::openDInput(unsigned int index)
                 return false;
             }
 
-            // Get device capabilities
-            result = m_device->GetCapabilities(&m_deviceCaps);
-
-            if (FAILED(result))
+            if (known)
             {
-                err() << "Failed to get DirectInput device capabilities: " << result << std::endl;
+                // Controls of the profile, the axis ranges are set for all axes at once
+                std::copy(std::begin(profile.axes), std::end(profile.axes), m_axes);
+                std::copy(std::begin(profile.povs), std::end(profile.povs), m_povs);
+                std::copy(std::begin(profile.buttons), std::end(profile.buttons), m_buttons);
 
-                m_device->Release();
-                m_device = nullptr;
+                DIPROPRANGE propertyRange;
 
-                return false;
+                std::memset(&propertyRange, 0, sizeof(propertyRange));
+                propertyRange.diph.dwSize = sizeof(propertyRange);
+                propertyRange.diph.dwHeaderSize = sizeof(propertyRange.diph);
+                propertyRange.diph.dwObj = 0;
+                propertyRange.diph.dwHow = DIPH_DEVICE;
+                propertyRange.lMin = -32768;
+                propertyRange.lMax = 32767;
+
+                const bool hasAxes = std::any_of(std::begin(m_axes), std::end(m_axes), [](int axis) { return axis != -1; });
+
+                if (hasAxes && (m_device->SetProperty(DIPROP_RANGE, &propertyRange.diph) != DI_OK))
+                    err() << "Failed to set DirectInput device axis property range" << std::endl;
             }
+            else
+            {
+                // Get device capabilities
+                result = m_device->GetCapabilities(&m_deviceCaps);
 
-            // set the cooperative level to let Direct Input know how this device
-            // interacts with the system and with other Direct Input devices (non-exlusive & background)
-            // result = m_device->SetCooperativeLevel(???, DISCL_NONEXCLUSIVE | DISCL_BACKGROUND );
-            // if (FAILED(result))
-            //     return result;
+                if (FAILED(result))
+                {
+                    err() << "Failed to get DirectInput device capabilities: " << result << std::endl;
 
-            // Enumerate device objects (axes/povs/buttons)
-            result = m_device->EnumObjects(&jsImpl::deviceObjectEnumerationCallback, this, DIDFT_AXIS | DIDFT_BUTTON | DIDFT_POV);
+                    m_device->Release();
+                    m_device = nullptr;
 
-            if (FAILED(result))
-            {
-                err() << "Failed to enumerate DirectInput device objects: " << result << std::endl;
+                    return false;
+                }
 
-                m_device->Release();
-                m_device = nullptr;
+                // set the cooperative level to let Direct Input know how this device
+                // interacts with the system and with other Direct Input devices (non-exlusive & background)
+                // result = m_device->SetCooperativeLevel(???, DISCL_NONEXCLUSIVE | DISCL_BACKGROUND );
+                // if (FAILED(result))
+                //     return result;
 
-                return false;
+                // Enumerate device objects (axes/povs/buttons)
+                result = m_device->EnumObjects(&jsImpl::deviceObjectEnumerationCallback, this, DIDFT_AXIS | DIDFT_BUTTON | DIDFT_POV);
+
+                if (FAILED(result))
+                {
+                    err() << "Failed to enumerate DirectInput device objects: " << result << std::endl;
+
+                    m_device->Release();
+                    m_device = nullptr;
+
+                    return false;
+                }
             }
 
+            // Map the offsets of all found objects to their controls for the buffered decode path
+            m_decode.build(m_axes, m_povs, m_buttons);
+
             // Set device's axis mode to absolute if the device reports having at least one axis
+            // (on every open: the mode is a property of the device instance, a profile only skips the enumeration)
             for (int axis : m_axes)
             {
                 if (axis != -1)
@@ -617,19 +1035,17 @@ bool jsImpl::openDInput(unsigned int index)
                         return false;
                     }
 
-                    // If the axis mode hasn't been set to absolute fail here and blacklist the device
+                    // If the axis mode hasn't been set to absolute fail here and refuse the device for this session
                     if (property.dwData != DIPROPAXISMODE_ABS)
                     {
-                        if (m_identification.vendorId && m_identification.productId)
-                        {
-                            jsBlacklistEntry entry;
+                        jsProfile rejected;
 
-                            entry.vendorId = m_identification.vendorId;
-                            entry.productId = m_identification.productId;
+                        rejected.vendorId = static_cast<std::uint16_t>(m_identification.vendorId);
+                        rejected.productId = static_cast<std::uint16_t>(m_identification.productId);
+                        rejected.nameHash = nameHash;
+                        rejected.flags = jsProfile::Rejected;
 
-                            jsBlacklist.push_back(entry);
-                            jsBlacklist.shrink_to_fit();
-                        }
+                        getProfiles().store(rejected);
 
                         m_device->Release();
                         m_device = nullptr;
@@ -641,19 +1057,27 @@ bool jsImpl::openDInput(unsigned int index)
                 }
             }
 
-            // Try to enable buffering by setting the buffer size
-            std::memset(&property, 0, sizeof(property));
-            property.diph.dwSize = sizeof(property);
-            property.diph.dwHeaderSize = sizeof(property.diph);
-            property.diph.dwHow = DIPH_DEVICE;
-            property.dwData = directInputEventBufferSize;
+            // Try to enable buffering by setting the buffer size (the profile tells if only polling is supported)
+            if (known && !(profile.flags & jsProfile::Buffered))
+            {
+                result = DI_POLLEDDEVICE;
+            }
+            else
+            {
+                std::memset(&property, 0, sizeof(property));
+                property.diph.dwSize = sizeof(property);
+                property.diph.dwHeaderSize = sizeof(property.diph);
+                property.diph.dwHow = DIPH_DEVICE;
+                property.dwData = min_eventBufferSize;
 
-            result = m_device->SetProperty(DIPROP_BUFFERSIZE, &property.diph);
+                result = m_device->SetProperty(DIPROP_BUFFERSIZE, &property.diph);
+            }
 
             if (result == DI_OK)
             {
                 // Buffering supported
                 m_buffered = true;
+                m_bufferSize = min_eventBufferSize;
             }
             else if (result == DI_POLLEDDEVICE)
             {
@@ -675,8 +1099,41 @@ bool jsImpl::openDInput(unsigned int index)
                 return false;
             }
 
+            // Let DirectInput signal new input, waitForInput() waits for it
+            // (polled devices only report input when they are polled)
+            if (m_buffered)
+            {
+                m_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+
+                if (m_event && FAILED(m_device->SetEventNotification(m_event)))
+                {
+                    CloseHandle(m_event);
+                    m_event = nullptr;
+                }
+            }
+
+            deviceEvents[index] = m_event;
+            if (!m_event)
+                polledMask |= 1u << index;
+
             // std::cout << "buffered = " << m_buffered << std::endl;
 
+            // Keep what was discovered: the next open of this device skips the discovery
+            if (!known)
+            {
+                jsProfile discovered;
+
+                discovered.vendorId = static_cast<std::uint16_t>(m_identification.vendorId);
+                discovered.productId = static_cast<std::uint16_t>(m_identification.productId);
+                discovered.nameHash = nameHash;
+                discovered.flags = static_cast<std::uint8_t>(m_buffered ? jsProfile::Buffered : 0);
+                std::copy(std::begin(m_axes), std::end(m_axes), discovered.axes);
+                std::copy(std::begin(m_povs), std::end(m_povs), discovered.povs);
+                std::copy(std::begin(m_buttons), std::end(m_buttons), discovered.buttons);
+
+                getProfiles().store(discovered);
+            }
+
             return true;
         }
     }
@@ -693,6 +1150,45 @@ void jsImpl::closeDInput()
         m_device->Release();
         m_device = nullptr;
     }
+
+    if (m_event)
+    {
+        CloseHandle(m_event);
+        m_event = nullptr;
+    }
+
+    deviceEvents[m_index] = nullptr;
+    polledMask &= ~(1u << m_index);
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::waitForInputDInput(DWORD timeout)
+{
+    HANDLE handles[1 + js::max_nJoystick];
+    DWORD count = 0;
+
+    if (hotplugEvent)
+        handles[count++] = hotplugEvent;
+
+    for (HANDLE event : deviceEvents)
+    {
+        if (event)
+            handles[count++] = event;
+    }
+
+    // Joysticks without notification are only noticed by polling them
+    if (polledMask != 0)
+        timeout = std::min(timeout, polledDeviceInterval);
+
+    if (count == 0)
+    {
+        Sleep(timeout);
+        return polledMask != 0;
+    }
+
+    DWORD result = WaitForMultipleObjects(count, handles, FALSE, timeout);
+
+    return (result < WAIT_OBJECT_0 + count) || (polledMask != 0);
 }
 
 ////////////////////////////////////////////////////////////
@@ -724,229 +1220,192 @@ jsCaps jsImpl::getCapabilitiesDInput() const
 }
 
 ////////////////////////////////////////////////////////////
-jsState jsImpl::updateDInputBuffered()
+bool jsImpl::updateDInputBuffered(jsState &state, const jsState &current, std::vector<js::Event> &events)
 {
-
-    // If we don't make it to the end of this function, mark the device as disconnected
-    m_state.connected = false;
-
     if (!m_device)
-        return m_state;
-
-    DIDEVICEOBJECTDATA events[directInputEventBufferSize];
-    DWORD eventCount = directInputEventBufferSize;
-
-    // Try to get the device data
-    HRESULT result = m_device->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), events, &eventCount, 0);
-
-    // If we have not acquired or have lost the device, attempt to (re-)acquire it and get the device data again
-    if ((result == DIERR_NOTACQUIRED) || (result == DIERR_INPUTLOST))
     {
-        m_device->Acquire();
-        result = m_device->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), events, &eventCount, 0);
+        state.connected = false;
+        return true;
     }
 
-    // If we still can't get the device data, assume it has been disconnected
-    if ((result == DIERR_NOTACQUIRED) || (result == DIERR_INPUTLOST))
-    {
-        m_device->Release();
-        m_device = nullptr;
+    DIDEVICEOBJECTDATA objectData[directInputEventChunkSize];
+    DWORD burst = 0;
+    bool overflow = false;
+    bool written = false;
 
-        return m_state;
-    }
+    // The new state is the current one plus the buffered changes: copy it only if there are any
+    auto beginWrite = [&]() {
+        if (!written)
+        {
+            state = current;
+            written = true;
+        }
+    };
 
-    if (FAILED(result))
+    // Drain the event buffer: keep reading until a read returns less than a full chunk
+    for (;;)
     {
-        err() << "Failed to get DirectInput device data: " << result << std::endl;
+        DWORD eventCount = directInputEventChunkSize;
 
-        return m_state;
-    }
+        // Try to get the device data
+        HRESULT result = m_device->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), objectData, &eventCount, 0);
 
-    // Iterate through all buffered events
-    for (DWORD i = 0; i < eventCount; ++i)
-    {
-        bool eventHandled = false;
+        // If we have not acquired or have lost the device, attempt to (re-)acquire it and get the device data again
+        if ((result == DIERR_NOTACQUIRED) || (result == DIERR_INPUTLOST))
+        {
+            m_device->Acquire();
+            eventCount = directInputEventChunkSize;
+            result = m_device->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), objectData, &eventCount, 0);
+        }
 
-        // Get the current state of each axis
-        for (int j = 0; j < js::max_nAxis; ++j)
+        // If we still can't get the device data, assume it has been disconnected
+        if ((result == DIERR_NOTACQUIRED) || (result == DIERR_INPUTLOST))
         {
-            if (m_axes[j] == static_cast<int>(events[i].dwOfs))
-            {
-                // if ((j == Axis::PovX) || (j == Axis::PovY))
-                // {
-                //     unsigned short value = LOWORD(events[i].dwData);
-
-                //     if (value != 0xFFFF)
-                //     {
-                //         float angle = (static_cast<float>(value)) * 3.141592654f / DI_DEGREES / 180.f;
-
-                //         m_state.axes[Axis::PovX] = std::sin(angle) * 100.f;
-                //         m_state.axes[Axis::PovY] = std::cos(angle) * 100.f;
-                //     }
-                //     else
-                //     {
-                //         m_state.axes[Axis::PovX] = 0.f;
-                //         m_state.axes[Axis::PovY] = 0.f;
-                //     }
-                // }
-                // else
-                {
-                    // map axis range to +/-100 (equivalent to 100% of full scale in each direction)
-                    m_state.axes[j] = (static_cast<float>(static_cast<short>(events[i].dwData)) + 0.5f) * 100.f / 32767.5f;
-                }
+            m_device->Release();
+            m_device = nullptr;
 
-                eventHandled = true;
-                break;
-            }
+            state.connected = false;
+            return true;
         }
 
-        if (eventHandled)
-            continue;
-
-        // Get the current state of each button
-        for (int j = 0; j < js::max_nButton; ++j)
+        if (FAILED(result))
         {
-            if (m_buttons[j] == static_cast<int>(events[i].dwOfs))
-            {
-                m_state.buttons[j] = (events[i].dwData != 0);
+            err() << "Failed to get DirectInput device data: " << result << std::endl;
 
-                eventHandled = true;
-                break;
-            }
+            state.connected = false;
+            return true;
         }
 
-        if (eventHandled)
-            continue;
+        // DI_BUFFEROVERFLOW is a success code: the events delivered are valid, but older ones are lost
+        if (result == DI_BUFFEROVERFLOW)
+            overflow = true;
+
+        if (eventCount > 0)
+            beginWrite();
+
+        // Event timestamps are GetTickCount() values: date them back from now, read after the events
+        const auto now = js::Event::Clock::now();
+        const DWORD nowTicks = GetTickCount();
 
-        // Get the current state of each pov
-        for (int j = 0; j < js::max_nPOV; ++j)
+        // Decode all buffered events: the offset of each event selects its control in one lookup
+        for (DWORD i = 0; i < eventCount; ++i)
         {
-            if (m_povs[j] == static_cast<int>(events[i].dwOfs))
-            {
-                unsigned short value = LOWORD(events[i].dwData);
+            const DIDEVICEOBJECTDATA &data = objectData[i];
+            const jsControl control = m_decode.decode(state, data.dwOfs, data.dwData);
 
-                if (value != 0xFFFF)
-                    m_state.povs[j] = static_cast<int>(value); // angles (in deg)
-                else
-                    m_state.povs[j] = -1; // -1 indicates center position
+            m_sequence = data.dwSequence;
 
-                eventHandled = true;
-                break;
-            }
+            if (control.kind != jsControl::None)
+                events.push_back(makeEvent(state, control, now - std::chrono::milliseconds(nowTicks - data.dwTimeStamp), m_sequence));
         }
-    }
 
-    m_state.connected = true;
+        burst += eventCount;
 
-    return m_state;
-}
+        if (eventCount < directInputEventChunkSize)
+            break;
+    }
 
-////////////////////////////////////////////////////////////
-jsState jsImpl::updateDInputPolled()
-{
-    jsState state;
+    if (overflow)
+    {
+        ++m_overflowCount;
+        m_resync = true;
+    }
 
-    if (m_device)
+    // Grow the event buffer if the burst came close to its size (requires an unacquired device)
+    unsigned int newSize = adaptEventBufferSize(m_bufferSize, burst, overflow);
+
+    if (newSize != 0)
     {
-        // Poll the device
-        m_device->Poll();
+        DIPROPDWORD property;
+        std::memset(&property, 0, sizeof(property));
+        property.diph.dwSize = sizeof(property);
+        property.diph.dwHeaderSize = sizeof(property.diph);
+        property.diph.dwHow = DIPH_DEVICE;
+        property.dwData = newSize;
+
+        m_device->Unacquire();
+        if (m_device->SetProperty(DIPROP_BUFFERSIZE, &property.diph) == DI_OK)
+            m_bufferSize = newSize;
+        m_device->Acquire();
 
-        DIJOYSTATE2 joystate;
+        // events arriving while the device was unacquired are not buffered
+        m_resync = true;
+    }
 
-        // Try to get the device state
-        HRESULT result = m_device->GetDeviceState(sizeof(joystate), &joystate);
+    // Initial state after open, or edges have been lost: resync all controls from a polled snapshot
+    if (m_resync)
+    {
+        DIJOYSTATE2 joystate;
 
-        // If we have not acquired or have lost the device, attempt to (re-)acquire it and get the device state again
-        if ((result == DIERR_NOTACQUIRED) || (result == DIERR_INPUTLOST))
+        m_device->Poll();
+        if (SUCCEEDED(m_device->GetDeviceState(sizeof(joystate), &joystate)))
         {
-            m_device->Acquire();
-            m_device->Poll();
-            result = m_device->GetDeviceState(sizeof(joystate), &joystate);
+            beginWrite();
+            const jsState before = state;
+            m_decode.decodeSnapshot(state, &joystate);
+            appendChangeEvents(events, before, state, js::Event::Clock::now(), ++m_sequence);
+            m_resync = false;
         }
+    }
 
-        // If we still can't get the device state, assume it has been disconnected
-        if ((result == DIERR_NOTACQUIRED) || (result == DIERR_INPUTLOST))
-        {
-            m_device->Release();
-            m_device = nullptr;
+    if (written)
+        state.connected = true;
 
-            return state;
-        }
+    return written;
+}
 
-        if (FAILED(result))
-        {
-            err() << "Failed to get DirectInput device state: " << result << std::endl;
+////////////////////////////////////////////////////////////
+bool jsImpl::updateDInputPolled(jsState &state, const jsState &current, std::vector<js::Event> &events)
+{
+    if (!m_device)
+    {
+        state.connected = false;
+        return true;
+    }
 
-            return state;
-        }
+    // Poll the device
+    m_device->Poll();
 
-        // Get the current state of each axis
-        for (int i = 0; i < js::max_nAxis; ++i)
-        {
-            if (m_axes[i] != -1)
-            {
-                // if ((i == Axis::PovX) || (i == Axis::PovY))
-                // {
-                //     unsigned short value = LOWORD(*reinterpret_cast<const DWORD *>(reinterpret_cast<const char *>(&joystate) + m_axes[i]));
-
-                //     if (value != 0xFFFF)
-                //     {
-                //         float angle = (static_cast<float>(value)) * 3.141592654f / DI_DEGREES / 180.f;
-
-                //         state.axes[Axis::PovX] = std::sin(angle) * 100.f;
-                //         state.axes[Axis::PovY] = std::cos(angle) * 100.f;
-                //     }
-                //     else
-                //     {
-                //         state.axes[Axis::PovX] = 0.f;
-                //         state.axes[Axis::PovY] = 0.f;
-                //     }
-                // }
-                // else
-                {
-                    // map axis range to +/-100 (equivalent to 100% of full scale in each direction)
-                    state.axes[i] = (static_cast<float>(*reinterpret_cast<const LONG *>(reinterpret_cast<const char *>(&joystate) + m_axes[i])) + 0.5f) * 100.f / 32767.5f;
-                }
-            }
-            else
-            {
-                state.axes[i] = 0.f;
-            }
-        }
+    DIJOYSTATE2 joystate;
 
-        // Get the current state of each button
-        for (int i = 0; i < js::max_nButton; ++i)
-        {
-            if (m_buttons[i] != -1)
-            {
-                BYTE value = *reinterpret_cast<const BYTE *>(reinterpret_cast<const char *>(&joystate) + m_buttons[i]);
+    // Try to get the device state
+    HRESULT result = m_device->GetDeviceState(sizeof(joystate), &joystate);
 
-                state.buttons[i] = ((value & 0x80) != 0);
-            }
-            else
-            {
-                state.buttons[i] = false;
-            }
-        }
+    // If we have not acquired or have lost the device, attempt to (re-)acquire it and get the device state again
+    if ((result == DIERR_NOTACQUIRED) || (result == DIERR_INPUTLOST))
+    {
+        m_device->Acquire();
+        m_device->Poll();
+        result = m_device->GetDeviceState(sizeof(joystate), &joystate);
+    }
 
-        // Get the current state of each pov
-        for (int i = 0; i < js::max_nPOV; ++i)
-        {
-            if (m_povs[i] != -1)
-            {
-                unsigned short value = LOWORD(*reinterpret_cast<const DWORD *>(reinterpret_cast<const char *>(&joystate) + m_povs[i]));
+    // If we still can't get the device state, assume it has been disconnected
+    if ((result == DIERR_NOTACQUIRED) || (result == DIERR_INPUTLOST))
+    {
+        m_device->Release();
+        m_device = nullptr;
 
-                if (value != 0xFFFF)
-                    state.povs[i] = static_cast<int>(value); // angles (in deg)
-                else
-                    state.povs[i] = -1; // -1 indicates center position
-            }
-        }
+        state.connected = false;
+        return true;
+    }
 
-        state.connected = true;
+    if (FAILED(result))
+    {
+        err() << "Failed to get DirectInput device state: " << result << std::endl;
+
+        state.connected = false;
+        return true;
     }
 
-    return state;
+    // A snapshot contains all mapped controls: it is decoded into a copy of the current state
+    // (which keeps the virtual pov buttons), its changes are dated to the time of the poll
+    state = current;
+    m_decode.decodeSnapshot(state, &joystate);
+    appendChangeEvents(events, current, state, js::Event::Clock::now(), ++m_sequence);
+
+    state.connected = true;
+
+    return true;
 }
 
 ////////////////////////////////////////////////////////////
@@ -975,27 +1434,48 @@ BOOL CALLBACK jsImpl::deviceObjectEnumerationCallback(const DIDEVICEOBJECTINSTAN
 
     if (DIDFT_GETTYPE(deviceObjectInstance->dwType) & DIDFT_AXIS)
     {
-        // Axes
+        // Axes: those beyond js::max_nAxis are not supported by this build
+        int axis = -1;
+        int offset = 0;
+
         if (deviceObjectInstance->guidType == guids::GUID_XAxis)
-            joystick.m_axes[js::Axis::X] = DIJOFS_X;
+        {
+            axis = js::Axis::X;
+            offset = DIJOFS_X;
+        }
         else if (deviceObjectInstance->guidType == guids::GUID_YAxis)
-            joystick.m_axes[js::Axis::Y] = DIJOFS_Y;
+        {
+            axis = js::Axis::Y;
+            offset = DIJOFS_Y;
+        }
         else if (deviceObjectInstance->guidType == guids::GUID_ZAxis)
-            joystick.m_axes[js::Axis::Z] = DIJOFS_Z;
+        {
+            axis = js::Axis::Z;
+            offset = DIJOFS_Z;
+        }
         else if (deviceObjectInstance->guidType == guids::GUID_RxAxis)
-            joystick.m_axes[js::Axis::Rx] = DIJOFS_RX;
+        {
+            axis = js::Axis::Rx;
+            offset = DIJOFS_RX;
+        }
         else if (deviceObjectInstance->guidType == guids::GUID_RyAxis)
-            joystick.m_axes[js::Axis::Ry] = DIJOFS_RY;
+        {
+            axis = js::Axis::Ry;
+            offset = DIJOFS_RY;
+        }
         else if (deviceObjectInstance->guidType == guids::GUID_RzAxis)
-            joystick.m_axes[js::Axis::Rz] = DIJOFS_RZ;
+        {
+            axis = js::Axis::Rz;
+            offset = DIJOFS_RZ;
+        }
         else if (deviceObjectInstance->guidType == guids::GUID_Slider)
         {
-
-            for (int i = 0; i < 2; ++i) // max. two sliders
+            for (int i = 0; (i < 2) && (js::Axis::S0 + i < js::max_nAxis); ++i) // max. two sliders
             {
                 if (joystick.m_axes[js::Axis::S0 + i] == -1)
                 {
-                    joystick.m_axes[js::Axis::S0 + i] = DIJOFS_SLIDER(i);
+                    axis = js::Axis::S0 + i;
+                    offset = DIJOFS_SLIDER(i);
                     break;
                 }
             }
@@ -1003,6 +1483,9 @@ BOOL CALLBACK jsImpl::deviceObjectEnumerationCallback(const DIDEVICEOBJECTINSTAN
         else
             return DIENUM_CONTINUE;
 
+        if ((axis != -1) && (axis < js::max_nAxis))
+            joystick.m_axes[axis] = offset;
+
         // Set the axis' value range to that of a signed short: [-32768, 32767]
         DIPROPRANGE propertyRange;
 
@@ -1056,6 +1539,8 @@ BOOL CALLBACK jsImpl::deviceObjectEnumerationCallback(const DIDEVICEOBJECTINSTAN
     return DIENUM_CONTINUE;
 }
 
+#endif // _WIN32
+
 } // namespace priv
 
 } // namespace hd
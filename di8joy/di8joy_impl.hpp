@@ -39,9 +39,15 @@
 
 // author: Daniel Hug, 2022
 
-// implements the the direct input backend services of the di8joy library
+// implements the backend services of the di8joy library
+// (DirectInput 8 on Windows, evdev on Linux)
 
 #include "di8joy.hpp"
+#include "di8joy_decode.hpp"
+#include "di8joy_profile.hpp"
+#include "di8joy_state.hpp"
+
+#if defined(_WIN32)
 
 // // for static linking
 // #pragma comment(lib, "dinput8.lib")
@@ -75,7 +81,20 @@
 
 #include <dinput.h>
 
+#elif defined(__linux__)
+
+#include <linux/input.h>
+
+#else
+#error "di8joy: unsupported platform (DirectInput 8 on Windows or evdev on Linux required)"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <iosfwd>
+#include <string>
+#include <vector>
 
 namespace hd
 {
@@ -85,20 +104,15 @@ std::ostream &err();
 namespace priv
 {
 
-struct jsCaps
-{
-    unsigned int nButton{0};    // actual number of buttons supported by the joystick (max. 128)
-    unsigned int nPOV{0};       // actual number of pov hats (max. 4)
-    bool axes[js::max_nAxis]{}; // support for each axis (max. 8)
-};
+// sets of joysticks are masks with bit i for joystick i
+static_assert(js::max_nJoystick <= 32, "joystick masks are 32 bit wide");
+constexpr std::uint32_t allJoysticksMask = static_cast<std::uint32_t>((std::uint64_t{1} << js::max_nJoystick) - 1);
 
-struct jsState
+enum class jsBackend
 {
-    bool connected{false};           // Is the joystick currently connected?
-    float axes[js::max_nAxis]{};     // Position of each axis, in range [-100.f, 100.f]
-    int povs[js::max_nPOV]{};        // Position of each pov hat (-1 for center pos, otherwise in deg starting from top with 0 in clockwise direction):
-                                     // center: -1, up: 0, U/R: 45, R: 90, D/R: 135, D: 180, D/L: 225, L: 270, U/L: 315
-    bool buttons[js::max_nButton]{}; // Status of each button (true = pressed)
+    Platform, // DirectInput 8 on windows, evdev on Linux
+    Replay,   // a recording (di8joy_impl_replay.cpp)
+    Synthetic // generated input (di8joy_impl_synthetic.cpp)
 };
 
 class jsImpl
@@ -108,12 +122,34 @@ class jsImpl
 
     static void cleanup(); // global cleanup
 
+    static jsBackend getBackend();
+
+    static void setBackend(jsBackend backend); // for joysticks opened from now on, close all joysticks before
+
     static bool isConnected(unsigned int jsIdx);
 
-    static void setLazyUpdates(bool status); // enable lazy update based on windows triggered enumeration updates
+    static std::uint32_t getConnectedMask(); // bit i set: joystick i is plugged in (as of the last updateConnections())
+
+    static void setLazyUpdates(bool status); // enable lazy update based on hotplug notifications (default: enabled)
+
+    static bool hasConnectionChanges(); // true if updateConnections() is due (hotplug notification or lazy updates off)
 
     static void updateConnections(); // Update the connection status of all joysticks
 
+    static void notifyConnectionsChanged(); // called by the hotplug watcher thread when devices come or go
+
+    // Capability profiles of the devices of the platform (di8joy_profile.hpp): opening
+    // a known device again takes its controls from its profile instead of enumerating them
+    static bool setProfileFile(const std::string &path); // keep the profiles in a file (empty: memory only)
+
+    static jsProfileCache &getProfiles(); // profiles of the devices of the platform
+
+    // Block until an open joystick has new input or joysticks were plugged in or out,
+    // returns false if timeout expired without any of that
+    static bool waitForInput(std::chrono::milliseconds timeout);
+
+    static void prepareUpdate(); // collect pending input of all open joysticks ahead of their update()
+
     [[nodiscard]] bool open(unsigned int jsIdx); // open joystick for reading status updates
 
     void close();
@@ -122,42 +158,162 @@ class jsImpl
 
     js::Id getId() const;
 
-    [[nodiscard]] jsState update();
+    unsigned int getOverflowCount() const; // input buffer overflows (lost events) since open()
+
+    // Write the new state of the joystick into state, based on its current state,
+    // and append its control changes to events (timestamped by the device).
+    // Returns false if there was no input, state is left untouched in that case.
+    // state holds leftovers of other joysticks: all of it is written if true is returned.
+    // A disconnected device is reported as state.connected == false.
+    [[nodiscard]] bool update(jsState &state, const jsState &current, std::vector<js::Event> &events);
+
+    // Replay of a recording (di8joy_impl_replay.cpp), replaces the joysticks of the platform
+    // while active; all joysticks have to be closed before starting or stopping it
+    static bool startReplay(const std::string &path, bool realTime); // realTime: as recorded, else max. speed
+
+    static void stopReplay(); // back to the joysticks of the platform
+
+    static bool isReplaying(); // replay backend active
+
+    static bool isReplayFinished(); // all records of the replay have been delivered
+
+    static std::uint32_t connectedMaskReplay();
+
+    static void prepareUpdateReplay(); // advance the replay clock, connect/disconnect joysticks on the way
+
+    static bool waitForInputReplay(std::chrono::milliseconds timeout);
+
+    [[nodiscard]] bool openReplay(unsigned int jsIdx);
+
+    void closeReplay();
+
+    jsCaps getCapabilitiesReplay() const;
+
+    [[nodiscard]] bool updateReplay(jsState &state, const jsState &current, std::vector<js::Event> &events);
+
+    // Synthetic joysticks (di8joy_impl_synthetic.cpp), replace the joysticks of the platform
+    // while active; all joysticks have to be closed before starting or stopping them
+    static void startSynthetic(const std::vector<js::SyntheticDevice> &devices, unsigned int seed);
+
+    static void stopSynthetic(); // back to the joysticks of the platform
+
+    static std::uint32_t connectedMaskSynthetic();
+
+    static void prepareUpdateSynthetic(); // take the time the input of all synthetic joysticks is generated up to
+
+    static bool waitForInputSynthetic(std::chrono::milliseconds timeout);
+
+    [[nodiscard]] bool openSynthetic(unsigned int jsIdx);
+
+    void closeSynthetic();
+
+    jsCaps getCapabilitiesSynthetic() const;
+
+    [[nodiscard]] bool updateSynthetic(jsState &state, const jsState &current, std::vector<js::Event> &events);
+
+#if defined(_WIN32)
 
     static void initializeDInput(); // global direct input initialization
 
     static void cleanupDInput(); // global cleanup of direct input
 
-    static bool isConnectedDInput(unsigned int jsIdx);
+    static std::uint32_t connectedMaskDInput(); // bit i set: a device with index i is in jsList
 
     static void updateConnectionsDInput();
 
+    static bool startHotplugWatcherDInput(); // thread with a message-only window receiving WM_DEVICECHANGE
+
+    static void stopHotplugWatcherDInput();
+
+    static bool waitForInputDInput(DWORD timeout); // WaitForMultipleObjects() on the notification events
+
     [[nodiscard]] bool openDInput(unsigned int jsIdx);
 
     void closeDInput();
 
     jsCaps getCapabilitiesDInput() const;
 
-    [[nodiscard]] jsState updateDInputBuffered();
+    [[nodiscard]] bool updateDInputBuffered(jsState &state, const jsState &current, std::vector<js::Event> &events);
 
-    [[nodiscard]] jsState updateDInputPolled();
+    [[nodiscard]] bool updateDInputPolled(jsState &state, const jsState &current, std::vector<js::Event> &events);
 
   private:
     static BOOL CALLBACK deviceEnumerationCallback(const DIDEVICEINSTANCE *deviceInstance, void *userData);
 
     static BOOL CALLBACK deviceObjectEnumerationCallback(const DIDEVICEOBJECTINSTANCE *deviceObjectInstance, void *userData);
 
+#elif defined(__linux__)
+
+    static void initializeEvdev(); // global evdev initialization (epoll instance)
+
+    static void cleanupEvdev(); // global cleanup of evdev
+
+    static std::uint32_t connectedMaskEvdev(); // bit i set: a device with index i is in jsList
+
+    static void updateConnectionsEvdev(); // scan /dev/input for joystick event devices
+
+    static bool startHotplugWatcherEvdev(); // thread watching /dev/input via inotify
+
+    static void stopHotplugWatcherEvdev();
+
+    static bool waitForInputEvdev(int timeout); // epoll_wait() on the open joysticks and the hotplug eventfd
+
+    static void prepareUpdateEvdev(); // one epoll_wait() for all open joysticks
+
+    [[nodiscard]] bool openEvdev(unsigned int jsIdx);
+
+    void closeEvdev();
+
+    jsCaps getCapabilitiesEvdev() const;
+
+    [[nodiscard]] bool updateEvdev(jsState &state, const jsState &current, std::vector<js::Event> &events);
+
+  private:
+    // query buttons, axes (with their ranges) and pov hats of the device, the open() of a device without profile
+    [[nodiscard]] bool discoverEvdev(int fd);
+
+    // read the complete device state via ioctl (after open or SYN_DROPPED)
+    void resyncEvdev(jsState &state, std::vector<js::Event> &events);
+
+    void setAxisEvdev(jsState &state, int axisIdx, int value);
+
+    void setPovEvdev(jsState &state, int povIdx);
+
+#endif
+
     // Member data
 
-    unsigned int m_index;           // Index of the joystick
+    unsigned int m_index; // Index of the joystick
+#if defined(_WIN32)
     IDirectInputDevice8W *m_device; // DirectInput 8.x device
     DIDEVCAPS m_deviceCaps;         // DirectInput device capabilities
     int m_axes[js::max_nAxis];      // Offsets to the bytes containing the axes states, -1 if not available
     int m_povs[js::max_nPOV];       // Offsets to the bytes containing the pov states, -1 if not available
     int m_buttons[js::max_nButton]; // Offsets to the bytes containing the button states, -1 if not available
-    js::Id m_identification;        // Joystick identification
-    jsState m_state;                // Buffered joystick state
-    bool m_buffered;                // true if the device uses buffering, false if the device uses polling
+    jsDecodeTable m_decode;         // Offset of a buffered event -> control (axis, button or pov)
+    DWORD m_bufferSize;             // Current size of the DirectInput event buffer (DIPROP_BUFFERSIZE)
+    HANDLE m_event;                 // Set by DirectInput on new input (SetEventNotification), nullptr if polled
+#elif defined(__linux__)
+    int m_fd{-1};                      // File descriptor of the event device (non-blocking, registered with epoll)
+    int m_axes[js::max_nAxis];         // ABS_* codes of the axes, -1 if not available
+    int m_povs[js::max_nPOV];          // Hat numbers n (ABS_HAT<n>X/Y) of the pov hats, -1 if not available
+    int m_buttons[js::max_nButton];    // KEY_*/BTN_* codes of the buttons, -1 if not available
+    signed char m_absToAxis[ABS_CNT];  // ABS_* code -> axis index, -1 if not mapped
+    signed char m_absToPov[ABS_CNT];   // ABS_HAT* code -> pov index, -1 if not mapped
+    short m_keyToButton[KEY_CNT];      // KEY_*/BTN_* code -> button index, -1 if not mapped
+    int m_axisMin[js::max_nAxis];      // Device minimum of each axis
+    int m_axisRange[js::max_nAxis];    // Device range (maximum - minimum) of each axis, 0 if unknown
+    int m_hats[js::max_nPOV][2];       // Last x/y value (-1, 0, 1) reported by each hat
+    bool m_dropped;                    // SYN_DROPPED seen, ignore events up to the next SYN_REPORT
+    bool m_monotonic;                  // Event timestamps use CLOCK_MONOTONIC (the clock of js::Event::Clock)
+    std::vector<input_event> m_events; // Read buffer, grows when a read() fills it completely
+#endif
+    js::Id m_identification;                      // Joystick identification
+    jsBackend m_backend{jsBackend::Platform};     // Backend the joystick was opened with
+    bool m_resync;                                // Read a complete snapshot at the next update (after open or lost events)
+    bool m_buffered;                              // true if the device uses buffering, false if the device uses polling
+    std::uint32_t m_sequence{0};                  // Sequence number of the latest event
+    std::atomic<unsigned int> m_overflowCount{0}; // Number of input buffer overflows (lost events) since open()
 };
 
 } // namespace priv
@@ -0,0 +1,892 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+// implements the evdev backend services of the di8joy library (Linux)
+//
+// all joystick event devices are opened non-blocking and registered with one
+// epoll instance. prepareUpdate() asks epoll once per tick which devices have
+// pending input, and update() drains the events of such a device with a single
+// read(). Devices without pending input cost no system call at all. The read
+// buffer of a device grows whenever a read() fills it completely.
+//
+// a watcher thread waits for inotify events of /dev/input and flags the
+// connections as changed, /dev/input is only rescanned after such a change.
+
+#include "di8joy_impl.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace
+{
+
+// anonymous namespace for things to be kept private to this translation unit
+
+int epollFd = -1;           // epoll instance all open joysticks are registered with
+int hotplugFd = -1;         // eventfd registered with epoll, written by the hotplug watcher
+unsigned int readyMask = 0; // bit i set: joystick i has pending input (or was unplugged)
+
+// epoll data of hotplugFd, open joysticks are registered with their index
+const std::uint32_t hotplugTag = 0xFFFFFFFF;
+
+struct jsRecord
+{
+    std::string path; // path of the event device, e.g. /dev/input/event12
+    unsigned int index;
+    bool plugged;
+};
+
+using JoystickList = std::vector<jsRecord>;
+JoystickList jsList;
+std::uint32_t connectedMask = 0; // bit i set: a device with index i is in jsList
+
+std::thread watcherThread; // hotplug watcher, waits for inotify events of /dev/input
+int inotifyFd = -1;        // inotify instance watching /dev/input
+int watcherStopFd = -1;    // eventfd telling the watcher thread to exit
+
+constexpr std::size_t bitsToLongs(std::size_t nBits)
+{
+    return (nBits + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long));
+}
+
+bool testBit(unsigned int bit, const unsigned long *bits)
+{
+    return (bits[bit / (8 * sizeof(unsigned long))] >> (bit % (8 * sizeof(unsigned long)))) & 1UL;
+}
+
+// pov position for hat values x/y in {-1, 0, 1}, indexed by [y + 1][x + 1]
+// (y = -1 is up); hundredths of a degree, -1 for center, as reported by DirectInput
+const int povAngle[3][3] = {{31500, 0, 4500}, {27000, -1, 9000}, {22500, 18000, 13500}};
+
+bool isJoystick(int fd)
+{
+    unsigned long keyBits[bitsToLongs(KEY_CNT)]{};
+    unsigned long absBits[bitsToLongs(ABS_CNT)]{};
+    unsigned long propBits[bitsToLongs(INPUT_PROP_CNT)]{};
+
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits) < 0 ||
+        ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(absBits)), absBits) < 0)
+        return false;
+
+    ioctl(fd, EVIOCGPROP(sizeof(propBits)), propBits);
+
+    // accelerometers of gamepads and phones report absolute x/y axes as well
+    if (testBit(INPUT_PROP_ACCELEROMETER, propBits))
+        return false;
+
+    // joystick and gamepad buttons (BTN_TRIGGER ... BTN_THUMBR, BTN_TRIGGER_HAPPY*)
+    for (unsigned int code = BTN_JOYSTICK; code < BTN_DIGI; ++code)
+    {
+        if (testBit(code, keyBits))
+            return true;
+    }
+
+    for (unsigned int code = BTN_TRIGGER_HAPPY; code <= BTN_TRIGGER_HAPPY40; ++code)
+    {
+        if (testBit(code, keyBits))
+            return true;
+    }
+
+    // x/y axes without buttons, but neither mouse nor touch device (e.g. pedals)
+    bool hasStick = testBit(ABS_X, absBits) && testBit(ABS_Y, absBits);
+    bool isPointer = testBit(BTN_MOUSE, keyBits) || testBit(BTN_TOUCH, keyBits) ||
+                     testBit(BTN_TOOL_FINGER, keyBits);
+
+    return hasStick && !isPointer;
+}
+
+} // anonymous namespace
+
+namespace hd
+{
+
+namespace priv
+{
+
+////////////////////////////////////////////////////////////
+void jsImpl::initializeEvdev()
+{
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (epollFd < 0)
+    {
+        err() << "Failed to create epoll instance: " << std::strerror(errno) << std::endl;
+
+        return;
+    }
+
+    // the hotplug watcher wakes up waitForInput() through this eventfd
+    hotplugFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u32 = hotplugTag;
+
+    if ((hotplugFd < 0) || (epoll_ctl(epollFd, EPOLL_CTL_ADD, hotplugFd, &event) < 0))
+        err() << "Failed to register hotplug eventfd with epoll: " << std::strerror(errno) << std::endl;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::cleanupEvdev()
+{
+    if (hotplugFd >= 0)
+    {
+        ::close(hotplugFd);
+        hotplugFd = -1;
+    }
+
+    if (epollFd >= 0)
+    {
+        ::close(epollFd);
+        epollFd = -1;
+    }
+
+    jsList.clear();
+}
+
+////////////////////////////////////////////////////////////
+std::uint32_t jsImpl::connectedMaskEvdev()
+{
+    return connectedMask;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::updateConnectionsEvdev()
+{
+    // Clear plugged flags so we can determine which devices were added/removed
+    for (jsRecord &record : jsList)
+        record.plugged = false;
+
+    // Enumerate event devices
+    DIR *directory = opendir("/dev/input");
+
+    if (directory)
+    {
+        while (const dirent *entry = readdir(directory))
+        {
+            if (std::strncmp(entry->d_name, "event", 5) != 0)
+                continue;
+
+            std::string path = std::string("/dev/input/") + entry->d_name;
+
+            bool known = false;
+            for (jsRecord &record : jsList)
+            {
+                if (record.path == path)
+                {
+                    record.plugged = true;
+                    known = true;
+                    break;
+                }
+            }
+
+            if (known)
+                continue;
+
+            // devices we are not allowed to read (e.g. keyboards) are skipped silently
+            int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+            if (fd < 0)
+                continue;
+
+            if (isJoystick(fd))
+                jsList.push_back(jsRecord{path, js::max_nJoystick, true});
+
+            ::close(fd);
+        }
+
+        closedir(directory);
+    }
+
+    // Remove devices that were not connected during the enumeration,
+    // the indices of the remaining ones make up the connected-slot mask
+    connectedMask = 0;
+    for (auto i = jsList.begin(); i != jsList.end();)
+    {
+        if (!i->plugged)
+        {
+            i = jsList.erase(i);
+        }
+        else
+        {
+            if (i->index < js::max_nJoystick)
+                connectedMask |= 1u << i->index;
+            ++i;
+        }
+    }
+
+    if (!directory)
+    {
+        err() << "Failed to enumerate evdev devices: " << std::strerror(errno) << std::endl;
+    }
+    else
+    {
+        // Assign the lowest unused joystick indices to devices that were newly connected
+        for (jsRecord &record : jsList)
+        {
+            if ((record.index == js::max_nJoystick) && (connectedMask != allJoysticksMask))
+            {
+                record.index = static_cast<unsigned int>(std::countr_one(connectedMask));
+                connectedMask |= 1u << record.index;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::startHotplugWatcherEvdev()
+{
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (inotifyFd < 0)
+    {
+        err() << "Failed to create inotify instance: " << std::strerror(errno) << std::endl;
+
+        return false;
+    }
+
+    // udev grants access to a new device node only after creating it, hence IN_ATTRIB
+    if (inotify_add_watch(inotifyFd, "/dev/input", IN_CREATE | IN_DELETE | IN_ATTRIB) < 0 ||
+        (watcherStopFd = eventfd(0, EFD_CLOEXEC)) < 0)
+    {
+        err() << "Failed to watch /dev/input: " << std::strerror(errno) << std::endl;
+
+        ::close(inotifyFd);
+        inotifyFd = -1;
+
+        return false;
+    }
+
+    watcherThread = std::thread([] {
+        pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {watcherStopFd, POLLIN, 0}};
+
+        for (;;)
+        {
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                break;
+            }
+
+            if (fds[1].revents)
+                break;
+
+            // drain all notifications, only changes of event devices need a rescan
+            alignas(inotify_event) char buffer[4096];
+            bool changed = false;
+            ssize_t size;
+
+            while ((size = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (ssize_t offset = 0; offset < size;)
+                {
+                    const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+
+                    if ((event->mask & IN_Q_OVERFLOW) ||
+                        (event->len > 0 && std::strncmp(event->name, "event", 5) == 0))
+                        changed = true;
+
+                    offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                }
+            }
+
+            if (changed)
+            {
+                notifyConnectionsChanged();
+
+                // wake up waitForInput()
+                std::uint64_t wakeUp = 1;
+                size = write(hotplugFd, &wakeUp, sizeof(wakeUp));
+            }
+        }
+    });
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::stopHotplugWatcherEvdev()
+{
+    std::uint64_t stop = 1;
+    if (write(watcherStopFd, &stop, sizeof(stop)) != sizeof(stop))
+        err() << "Failed to stop the hotplug watcher: " << std::strerror(errno) << std::endl;
+
+    watcherThread.join();
+
+    ::close(watcherStopFd);
+    ::close(inotifyFd);
+    watcherStopFd = -1;
+    inotifyFd = -1;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::prepareUpdateEvdev()
+{
+    readyMask = 0;
+
+    if (epollFd < 0)
+        return;
+
+    epoll_event events[js::max_nJoystick + 1];
+
+    int eventCount = epoll_wait(epollFd, events, js::max_nJoystick + 1, 0);
+
+    for (int i = 0; i < eventCount; ++i)
+    {
+        if (events[i].data.u32 == hotplugTag)
+        {
+            // reset the eventfd, the connections are rescanned by the watcher's flag
+            std::uint64_t count;
+            [[maybe_unused]] ssize_t size = ::read(hotplugFd, &count, sizeof(count));
+        }
+        else
+        {
+            readyMask |= 1u << events[i].data.u32;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::waitForInputEvdev(int timeout)
+{
+    if (epollFd < 0)
+        return false;
+
+    // level-triggered: the events stay pending for prepareUpdate()
+    epoll_event events[js::max_nJoystick + 1];
+
+    int eventCount;
+    do
+    {
+        eventCount = epoll_wait(epollFd, events, js::max_nJoystick + 1, timeout);
+    } while ((eventCount < 0) && (errno == EINTR));
+
+    return eventCount > 0;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::openEvdev(unsigned int index)
+{
+    // Initialize evdev members
+    m_index = index;
+    m_fd = -1;
+
+    for (int &axis : m_axes)
+        axis = -1;
+
+    for (int &pov : m_povs)
+        pov = -1;
+
+    for (int &button : m_buttons)
+        button = -1;
+
+    std::memset(m_absToAxis, -1, sizeof(m_absToAxis));
+    std::memset(m_absToPov, -1, sizeof(m_absToPov));
+    for (short &button : m_keyToButton)
+        button = -1;
+
+    std::memset(m_hats, 0, sizeof(m_hats));
+    m_identification = js::Id();
+    m_resync = true;
+    m_buffered = true;
+    m_dropped = false;
+    m_monotonic = false;
+    m_overflowCount = 0;
+    m_events.resize(2 * min_eventBufferSize);
+
+    // Search for a joystick with the given index in the connected list
+    for (const jsRecord &record : jsList)
+    {
+        if (record.index == index)
+        {
+            int fd = ::open(record.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+            if (fd < 0)
+            {
+                err() << "Failed to open evdev device " << record.path << ": " << std::strerror(errno) << std::endl;
+
+                return false;
+            }
+
+            // Get vendor and product id of the device
+            input_id id{};
+
+            if (ioctl(fd, EVIOCGID, &id) >= 0)
+            {
+                m_identification.vendorId = id.vendor;
+                m_identification.productId = id.product;
+            }
+
+            // Get product name of the device
+            char name[256]{};
+
+            if (ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name) >= 0)
+            {
+                m_identification.name.clear();
+                for (const char *c = name; *c; ++c)
+                    m_identification.name += static_cast<wchar_t>(static_cast<unsigned char>(*c));
+            }
+
+            // A device seen before is opened from its profile, others are queried for their controls
+            const std::uint32_t nameHash = jsProfileCache::hash(m_identification.name);
+            jsProfile profile;
+            const bool known = getProfiles().find(m_identification.vendorId, m_identification.productId, nameHash, profile);
+
+            if (known)
+            {
+                std::copy(std::begin(profile.axes), std::end(profile.axes), m_axes);
+                std::copy(std::begin(profile.povs), std::end(profile.povs), m_povs);
+                std::copy(std::begin(profile.buttons), std::end(profile.buttons), m_buttons);
+                std::copy(std::begin(profile.axisMin), std::end(profile.axisMin), m_axisMin);
+                std::copy(std::begin(profile.axisRange), std::end(profile.axisRange), m_axisRange);
+            }
+            else
+            {
+                if (!discoverEvdev(fd))
+                {
+                    ::close(fd);
+
+                    return false;
+                }
+
+                // Keep what was discovered: the next open of this device skips the discovery
+                jsProfile discovered;
+
+                discovered.vendorId = static_cast<std::uint16_t>(m_identification.vendorId);
+                discovered.productId = static_cast<std::uint16_t>(m_identification.productId);
+                discovered.nameHash = nameHash;
+                discovered.flags = jsProfile::Buffered;
+                std::copy(std::begin(m_axes), std::end(m_axes), discovered.axes);
+                std::copy(std::begin(m_povs), std::end(m_povs), discovered.povs);
+                std::copy(std::begin(m_buttons), std::end(m_buttons), discovered.buttons);
+                std::copy(std::begin(m_axisMin), std::end(m_axisMin), discovered.axisMin);
+                std::copy(std::begin(m_axisRange), std::end(m_axisRange), discovered.axisRange);
+
+                getProfiles().store(discovered);
+            }
+
+            // Map the event codes to the controls
+            for (int i = 0; i < js::max_nButton; ++i)
+            {
+                if ((m_buttons[i] >= 0) && (m_buttons[i] < KEY_CNT))
+                    m_keyToButton[m_buttons[i]] = static_cast<short>(i);
+            }
+
+            for (int i = 0; i < js::max_nAxis; ++i)
+            {
+                if ((m_axes[i] >= 0) && (m_axes[i] < ABS_CNT))
+                    m_absToAxis[m_axes[i]] = static_cast<signed char>(i);
+            }
+
+            for (int i = 0; i < js::max_nPOV; ++i)
+            {
+                if ((m_povs[i] >= 0) && (m_povs[i] < 4))
+                {
+                    m_absToPov[ABS_HAT0X + 2 * m_povs[i]] = static_cast<signed char>(i);
+                    m_absToPov[ABS_HAT0X + 2 * m_povs[i] + 1] = static_cast<signed char>(i);
+                }
+            }
+
+            // Timestamp events on the clock of js::Event::Clock (the default is CLOCK_REALTIME)
+            int clockId = CLOCK_MONOTONIC;
+            m_monotonic = (ioctl(fd, EVIOCSCLOCKID, &clockId) >= 0);
+
+            // Register the device with epoll, its slot index is handed back by epoll_wait
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u32 = index;
+
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+            {
+                err() << "Failed to register evdev device with epoll: " << std::strerror(errno) << std::endl;
+
+                ::close(fd);
+
+                return false;
+            }
+
+            // events sent before opening are not queued for us: the first update
+            // starts from a full snapshot (m_resync)
+            m_fd = fd;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::discoverEvdev(int fd)
+{
+    unsigned long keyBits[bitsToLongs(KEY_CNT)]{};
+    unsigned long absBits[bitsToLongs(ABS_CNT)]{};
+
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits) < 0 ||
+        ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(absBits)), absBits) < 0)
+    {
+        err() << "Failed to query evdev device capabilities: " << std::strerror(errno) << std::endl;
+
+        return false;
+    }
+
+    // Buttons: same order as the linux joystick driver (joydev) uses,
+    // i.e. BTN_MISC and above first, then the keys below BTN_MISC
+    int nButton = 0;
+    auto addButton = [&](unsigned int code) {
+        if (testBit(code, keyBits) && (nButton < js::max_nButton))
+        {
+            m_buttons[nButton] = static_cast<int>(code);
+            ++nButton;
+        }
+    };
+
+    for (unsigned int code = BTN_MISC; code < KEY_CNT; ++code)
+        addButton(code);
+
+    for (unsigned int code = 0; code < BTN_MISC; ++code)
+        addButton(code);
+
+    // Axes: fixed assignment for X ... Rz, the first two of the remaining
+    // absolute controls found become the sliders S0 and S1
+    const int axisCodes[] = {ABS_X, ABS_Y, ABS_Z, ABS_RX, ABS_RY, ABS_RZ};
+    for (int i = 0; (i < 6) && (i < js::max_nAxis); ++i)
+    {
+        if (testBit(axisCodes[i], absBits))
+            m_axes[i] = axisCodes[i];
+    }
+
+    const int sliderCodes[] = {ABS_THROTTLE, ABS_RUDDER, ABS_WHEEL, ABS_GAS, ABS_BRAKE, ABS_MISC};
+    int nSlider = 0;
+    for (int code : sliderCodes)
+    {
+        if (testBit(code, absBits) && (js::Axis::S0 + nSlider < js::max_nAxis))
+            m_axes[js::Axis::S0 + nSlider++] = code;
+    }
+
+    for (int i = 0; i < js::max_nAxis; ++i)
+    {
+        m_axisMin[i] = 0;
+        m_axisRange[i] = 0;
+
+        if (m_axes[i] == -1)
+            continue;
+
+        // the axis range is mapped to +/-100% of full scale in each direction
+        input_absinfo info{};
+
+        if ((ioctl(fd, EVIOCGABS(m_axes[i]), &info) >= 0) && (info.maximum > info.minimum))
+        {
+            m_axisMin[i] = info.minimum;
+            m_axisRange[i] = info.maximum - info.minimum;
+        }
+    }
+
+    // POV hats: a hat is reported as a pair of axes ABS_HAT<n>X/ABS_HAT<n>Y
+    int nPov = 0;
+    for (int hat = 0; (hat < 4) && (nPov < js::max_nPOV); ++hat)
+    {
+        int codeX = ABS_HAT0X + 2 * hat;
+
+        if (testBit(codeX, absBits) || testBit(codeX + 1, absBits))
+        {
+            m_povs[nPov] = hat;
+            ++nPov;
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::closeEvdev()
+{
+    if (m_fd >= 0)
+    {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, m_fd, nullptr);
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+////////////////////////////////////////////////////////////
+jsCaps jsImpl::getCapabilitiesEvdev() const
+{
+    jsCaps caps;
+
+    // Count how many buttons are mapped
+    caps.nButton = 0;
+    for (int button : m_buttons)
+    {
+        if (button != -1)
+            ++caps.nButton;
+    }
+
+    // Count how many pov hats are mapped
+    caps.nPOV = 0;
+    for (int pov : m_povs)
+    {
+        if (pov != -1)
+            ++caps.nPOV;
+    }
+
+    // Check which axes are mapped
+    for (int i = 0; i < js::max_nAxis; ++i)
+        caps.axes[i] = (m_axes[i] != -1);
+
+    return caps;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::updateEvdev(jsState &state, const jsState &current, std::vector<js::Event> &events)
+{
+    if (m_fd < 0)
+    {
+        state.connected = false;
+        return true;
+    }
+
+    bool written = false;
+
+    // The new state is the current one plus the pending changes: copy it only if there are any
+    auto beginWrite = [&]() {
+        if (!written)
+        {
+            state = current;
+            state.connected = true;
+            written = true;
+        }
+    };
+
+    if (m_resync)
+    {
+        beginWrite();
+        resyncEvdev(state, events);
+        m_resync = false;
+    }
+
+    // Nothing reported by epoll: the state is unchanged, no need to ask the kernel
+    if (!(readyMask & (1u << m_index)))
+        return written;
+
+    // Drain the pending events with one read(); if there are more than fit
+    // into the buffer, epoll reports the device again on the next update
+    ssize_t result = ::read(m_fd, m_events.data(), m_events.size() * sizeof(input_event));
+
+    if (result < 0)
+    {
+        if ((errno == EAGAIN) || (errno == EINTR))
+            return written;
+
+        // ENODEV: the device has been unplugged
+        closeEvdev();
+        state.connected = false;
+
+        return true;
+    }
+
+    std::size_t eventCount = static_cast<std::size_t>(result) / sizeof(input_event);
+
+    // Time at which the device reported an event (time of the read if its clock could not be switched)
+    auto eventTime = [this](const input_event &event) {
+        if (!m_monotonic)
+            return js::Event::Clock::now();
+
+        return js::Event::Clock::time_point(std::chrono::seconds(event.input_event_sec) +
+                                            std::chrono::microseconds(event.input_event_usec));
+    };
+
+    if (eventCount > 0)
+        beginWrite();
+
+    for (std::size_t i = 0; i < eventCount; ++i)
+    {
+        const input_event &event = m_events[i];
+
+        // After an overflow of the kernel buffer the events up to the next
+        // SYN_REPORT are incomplete: skip them and re-read the full state
+        if (m_dropped)
+        {
+            if ((event.type == EV_SYN) && (event.code == SYN_REPORT))
+            {
+                m_dropped = false;
+                resyncEvdev(state, events);
+            }
+            continue;
+        }
+
+        switch (event.type)
+        {
+        case EV_KEY:
+            if ((event.code < KEY_CNT) && (m_keyToButton[event.code] != -1))
+            {
+                int button = m_keyToButton[event.code];
+
+                if (state.buttons.test(button) != (event.value != 0)) // 2 = autorepeat
+                {
+                    state.buttons.set(button, event.value != 0);
+                    events.push_back(makeEvent(state, jsControl{jsControl::Button, static_cast<unsigned char>(button)},
+                                               eventTime(event), m_sequence));
+                }
+            }
+            break;
+
+        case EV_ABS:
+            if (event.code < ABS_CNT)
+            {
+                if (m_absToAxis[event.code] != -1)
+                {
+                    int axis = m_absToAxis[event.code];
+                    const js::axis_t position = state.axes[axis];
+                    setAxisEvdev(state, axis, event.value);
+
+                    if (state.axes[axis] != position)
+                        events.push_back(makeEvent(state, jsControl{jsControl::Axis, static_cast<unsigned char>(axis)},
+                                                   eventTime(event), m_sequence));
+                }
+                else if (m_absToPov[event.code] != -1)
+                {
+                    int pov = m_absToPov[event.code];
+                    int position = state.povs[pov];
+                    m_hats[pov][(event.code - ABS_HAT0X) & 1] = event.value;
+                    setPovEvdev(state, pov);
+
+                    if (state.povs[pov] != position)
+                        events.push_back(makeEvent(state, jsControl{jsControl::Pov, static_cast<unsigned char>(pov)},
+                                                   eventTime(event), m_sequence));
+                }
+            }
+            break;
+
+        case EV_SYN:
+            // the changes of one SYN_REPORT frame were reported together
+            if (event.code == SYN_REPORT)
+                ++m_sequence;
+
+            if (event.code == SYN_DROPPED)
+            {
+                // the kernel buffer of the device overflowed
+                m_dropped = true;
+                ++m_overflowCount;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    // Grow the read buffer if it was filled completely, the next read then catches up
+    unsigned int newSize = adaptEventBufferSize(static_cast<unsigned int>(m_events.size()),
+                                                static_cast<unsigned int>(eventCount), false);
+    if (newSize != 0)
+        m_events.resize(newSize);
+
+    return written;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::resyncEvdev(jsState &state, std::vector<js::Event> &events)
+{
+    const jsState before = state;
+
+    unsigned long keyState[bitsToLongs(KEY_CNT)]{};
+
+    if (ioctl(m_fd, EVIOCGKEY(sizeof(keyState)), keyState) >= 0)
+        setMappedButtons(state, m_buttons, [&](int code) { return testBit(static_cast<unsigned int>(code), keyState); });
+
+    input_absinfo info{};
+
+    for (int i = 0; i < js::max_nAxis; ++i)
+    {
+        if ((m_axes[i] != -1) && (ioctl(m_fd, EVIOCGABS(m_axes[i]), &info) >= 0))
+            setAxisEvdev(state, i, info.value);
+    }
+
+    for (int i = 0; i < js::max_nPOV; ++i)
+    {
+        if (m_povs[i] == -1)
+            continue;
+
+        for (int j = 0; j < 2; ++j)
+        {
+            if (ioctl(m_fd, EVIOCGABS(ABS_HAT0X + 2 * m_povs[i] + j), &info) >= 0)
+                m_hats[i][j] = info.value;
+        }
+
+        setPovEvdev(state, i);
+    }
+
+    appendChangeEvents(events, before, state, js::Event::Clock::now(), m_sequence++);
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::setAxisEvdev(jsState &state, int axisIdx, int value)
+{
+    state.axes[axisIdx] = (m_axisRange[axisIdx] > 0) ? axisFromRange(value, m_axisMin[axisIdx], m_axisRange[axisIdx]) : js::axis_t{};
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::setPovEvdev(jsState &state, int povIdx)
+{
+    int x = (m_hats[povIdx][0] > 0) - (m_hats[povIdx][0] < 0);
+    int y = (m_hats[povIdx][1] > 0) - (m_hats[povIdx][1] < 0);
+
+    state.povs[povIdx] = povAngle[y + 1][x + 1];
+}
+
+} // namespace priv
+
+} // namespace hd
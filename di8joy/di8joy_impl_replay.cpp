@@ -0,0 +1,418 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+// implements the replay backend of the di8joy library (all platforms)
+//
+// A recording (see di8joy_record.hpp) is mapped into memory. prepareUpdate()
+// advances the replay clock - to the current time since the start of the replay,
+// or to the time of the next record at maximum speed - and connects or disconnects
+// joysticks on the way. update() then applies the records of its joystick up to
+// that time, exactly as a platform backend applies the events of its device.
+
+#include "di8joy_impl.hpp"
+#include "di8joy_record.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+// windows.h is included by di8joy_impl.hpp
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// anonymous namespace for things to be kept private to this translation unit
+
+struct jsReplaySlot
+{
+    bool plugged{false};     // Between a Connected and a Disconnected record
+    hd::priv::jsCaps caps;   // Capabilities of the Connected record
+    hd::js::Id id;           // Identification of the Identified record
+};
+
+bool realTimeReplay = false;                       // deliver records as recorded, else at max. speed
+const void *mapping = nullptr;                     // recording mapped into memory
+std::size_t mappingSize = 0;                       // size of the mapping in bytes
+const hd::priv::jsRecordEntry *entries = nullptr;  // records of the recording
+std::size_t entryCount = 0;                        // number of records
+std::size_t cursor = 0;                            // first record not yet delivered
+std::size_t rangeBegin = 0;                        // records delivered by the current update(): [rangeBegin, cursor)
+hd::js::Event::Clock::time_point replayStart;      // time 0 of the recording
+jsReplaySlot slots[hd::js::max_nJoystick];         // joysticks of the recording
+std::uint32_t connectedMask = 0;                   // bit i set: slots[i].plugged
+
+#if defined(_WIN32)
+HANDLE mappingHandle = nullptr; // file mapping object of the recording
+#endif
+
+void unmapRecording()
+{
+#if defined(_WIN32)
+    if (mapping)
+        UnmapViewOfFile(mapping);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    mappingHandle = nullptr;
+#else
+    if (mapping)
+        munmap(const_cast<void *>(mapping), mappingSize);
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+}
+
+bool mapRecording(const std::string &path)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && (size.QuadPart > 0))
+    {
+        mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle)
+            mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        mappingSize = static_cast<std::size_t>(size.QuadPart);
+    }
+
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if ((fstat(fd, &info) == 0) && (info.st_size > 0))
+    {
+        void *address = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (address != MAP_FAILED)
+        {
+            // the records are read once from front to back
+            madvise(address, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+            mapping = address;
+            mappingSize = static_cast<std::size_t>(info.st_size);
+        }
+    }
+
+    ::close(fd);
+#endif
+
+    if (!mapping)
+        unmapRecording();
+
+    return mapping != nullptr;
+}
+
+} // anonymous namespace
+
+namespace hd
+{
+
+namespace priv
+{
+
+////////////////////////////////////////////////////////////
+bool jsImpl::startReplay(const std::string &path, bool realTime)
+{
+    stopReplay();
+    stopSynthetic();
+
+    if (!mapRecording(path))
+    {
+        err() << "Failed to map recording " << path << std::endl;
+
+        return false;
+    }
+
+    const auto *header = static_cast<const jsRecordHeader *>(mapping);
+
+    if ((mappingSize < sizeof(jsRecordHeader)) || (std::memcmp(header->magic, "J2KR", 4) != 0) ||
+        (header->version != jsRecordHeader::current))
+    {
+        err() << "Not a recording of this version: " << path << std::endl;
+
+        unmapRecording();
+
+        return false;
+    }
+
+    // a recording cut off while writing ends with the last complete record
+    entries = reinterpret_cast<const jsRecordEntry *>(static_cast<const char *>(mapping) + sizeof(jsRecordHeader));
+    entryCount = (mappingSize - sizeof(jsRecordHeader)) / sizeof(jsRecordEntry);
+    cursor = 0;
+    rangeBegin = 0;
+    replayStart = js::Event::Clock::now();
+    realTimeReplay = realTime;
+    connectedMask = 0;
+    for (jsReplaySlot &slot : slots)
+        slot = jsReplaySlot();
+
+    setBackend(jsBackend::Replay);
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::stopReplay()
+{
+    if (getBackend() != jsBackend::Replay)
+        return;
+
+    unmapRecording();
+    entries = nullptr;
+    entryCount = 0;
+    connectedMask = 0;
+
+    setBackend(jsBackend::Platform);
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::isReplaying()
+{
+    return getBackend() == jsBackend::Replay;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::isReplayFinished()
+{
+    return cursor >= entryCount;
+}
+
+////////////////////////////////////////////////////////////
+std::uint32_t jsImpl::connectedMaskReplay()
+{
+    return connectedMask;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::prepareUpdateReplay()
+{
+    rangeBegin = cursor;
+
+    if (cursor >= entryCount)
+        return;
+
+    // real time: everything recorded until now, max. speed: the next point in time of the recording
+    std::uint64_t until = entries[cursor].time;
+
+    if (realTimeReplay)
+        until = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(js::Event::Clock::now() - replayStart).count());
+
+    for (; (cursor < entryCount) && (entries[cursor].time <= until); ++cursor)
+    {
+        const jsRecordEntry &entry = entries[cursor];
+
+        if (entry.joystick >= js::max_nJoystick)
+            continue;
+
+        jsReplaySlot &slot = slots[entry.joystick];
+
+        switch (entry.type)
+        {
+        case jsRecordEntry::Connected:
+            slot.plugged = true;
+            slot.caps.nButton = std::min<unsigned int>(entry.value & 0xFF, js::max_nButton);
+            slot.caps.nPOV = std::min<unsigned int>((entry.value >> 8) & 0xFF, js::max_nPOV);
+            for (unsigned int i = 0; i < js::max_nAxis; ++i)
+                slot.caps.axes[i] = ((entry.value >> (16 + i)) & 1u) != 0;
+            slot.id = js::Id();
+            slot.id.name = L"Replay of joystick " + std::to_wstring(entry.joystick);
+            connectedMask |= 1u << entry.joystick;
+            notifyConnectionsChanged();
+            break;
+
+        case jsRecordEntry::Identified:
+            slot.id.vendorId = entry.value >> 16;
+            slot.id.productId = entry.value & 0xFFFF;
+            break;
+
+        case jsRecordEntry::Disconnected:
+            slot.plugged = false;
+            connectedMask &= ~(1u << entry.joystick);
+            notifyConnectionsChanged();
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::waitForInputReplay(std::chrono::milliseconds timeout)
+{
+    if (cursor >= entryCount)
+    {
+        std::this_thread::sleep_for(timeout);
+        return false;
+    }
+
+    if (!realTimeReplay)
+        return true;
+
+    // sleep until the next record is due
+    const auto due = replayStart + std::chrono::microseconds(entries[cursor].time);
+    const auto deadline = js::Event::Clock::now() + timeout;
+
+    std::this_thread::sleep_until(std::min(due, deadline));
+
+    return due <= deadline;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::openReplay(unsigned int index)
+{
+    m_index = index;
+    m_identification = slots[index].id;
+    m_resync = true;
+    m_buffered = true;
+    m_overflowCount = 0;
+
+    return slots[index].plugged;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::closeReplay()
+{
+}
+
+////////////////////////////////////////////////////////////
+jsCaps jsImpl::getCapabilitiesReplay() const
+{
+    return slots[m_index].caps;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::updateReplay(jsState &state, const jsState &current, std::vector<js::Event> &events)
+{
+    bool written = false;
+
+    // The new state is the current one plus the records of this joystick: copy it only if there are any
+    auto beginWrite = [&]() {
+        if (!written)
+        {
+            state = current;
+            state.connected = true;
+            written = true;
+        }
+    };
+
+    // after open: the recorded events start from a neutral state
+    if (m_resync)
+    {
+        beginWrite();
+        m_resync = false;
+    }
+
+    std::uint64_t sequenceTime = ~std::uint64_t{0};
+
+    for (std::size_t i = rangeBegin; i < cursor; ++i)
+    {
+        const jsRecordEntry &entry = entries[i];
+
+        if (entry.joystick != m_index)
+            continue;
+
+        if (entry.type == jsRecordEntry::Disconnected)
+        {
+            state.connected = false;
+            return true;
+        }
+
+        if (entry.type > js::Event::PovMoved)
+            continue;
+
+        beginWrite();
+
+        // records of the same point in time were reported together
+        if (entry.time != sequenceTime)
+        {
+            ++m_sequence;
+            sequenceTime = entry.time;
+        }
+
+        jsControl control{jsControl::Button, entry.index};
+
+        switch (entry.type)
+        {
+        case js::Event::AxisMoved:
+        {
+            if (entry.index >= js::max_nAxis)
+                continue;
+            control.kind = jsControl::Axis;
+            float percent;
+            std::memcpy(&percent, &entry.value, sizeof(float));
+            state.axes[entry.index] = js::axisFromPercent(percent);
+        }
+        break;
+
+        case js::Event::PovMoved:
+            if (entry.index >= js::max_nPOV)
+                continue;
+            control.kind = jsControl::Pov;
+            state.povs[entry.index] = static_cast<int>(entry.value);
+            break;
+
+        default:
+            if (entry.index >= js::max_nButton)
+                continue;
+            state.buttons.set(entry.index, entry.type == js::Event::ButtonPressed);
+            break;
+        }
+
+        events.push_back(makeEvent(state, control, replayStart + std::chrono::microseconds(entry.time), m_sequence));
+    }
+
+    return written;
+}
+
+} // namespace priv
+
+} // namespace hd
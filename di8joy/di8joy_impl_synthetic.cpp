@@ -0,0 +1,379 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+// implements the synthetic backend of the di8joy library (all platforms)
+//
+// Generates the input of up to max_nJoystick joysticks as configured by
+// js::startSynthetic(), for load and scaling tests without real devices.
+// prepareUpdate() takes the current time, update() then generates the changes
+// of its joystick that are due up to that time - random or bursty changes with
+// exponentially distributed intervals, or a script repeated in a loop - and
+// applies them exactly as a platform backend applies the events of its device.
+
+#include "di8joy_impl.hpp"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+
+namespace
+{
+
+// anonymous namespace for things to be kept private to this translation unit
+
+using Clock = hd::js::Event::Clock;
+
+struct jsSyntheticSlot
+{
+    hd::js::SyntheticDevice config; // How the input is generated
+    hd::priv::jsCaps caps;          // Controls of the joystick as derived from config
+    hd::js::Id id;                  // Identification of the joystick
+    std::mt19937 random;            // Generator of intervals, controls and positions
+    double rate{0.0};               // Mean changes (Random) or bursts (Bursty) per second
+    Clock::time_point next;         // Time of the next change, burst or script event
+    Clock::time_point loopStart;    // Scripted: start of the current loop
+    Clock::duration loopLength{};   // Scripted: length of one loop
+    std::size_t scriptIndex{0};     // Scripted: next event of the script
+};
+
+std::vector<jsSyntheticSlot> slots; // one per configured joystick, max. js::max_nJoystick
+Clock::time_point now;             // input is generated up to this time (set by prepareUpdate())
+
+// max. time of input generated at once, if update() has not been called for longer the rest is dropped
+constexpr std::chrono::seconds maxBacklog{1};
+
+// time of the next change, burst or script event after the previous one
+Clock::time_point nextTime(jsSyntheticSlot &slot, Clock::time_point previous)
+{
+    if (slot.config.pattern == hd::js::SyntheticDevice::Scripted)
+    {
+        const std::vector<hd::js::Event> &script = slot.config.script;
+
+        if (slot.scriptIndex >= script.size())
+        {
+            slot.scriptIndex = 0;
+            slot.loopStart += slot.loopLength;
+        }
+
+        return slot.loopStart + script[slot.scriptIndex].time.time_since_epoch();
+    }
+
+    if (slot.rate <= 0.0)
+        return Clock::time_point::max();
+
+    std::exponential_distribution<double> interval(slot.rate);
+
+    return previous + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval(slot.random)));
+}
+
+} // anonymous namespace
+
+namespace hd
+{
+
+namespace priv
+{
+
+////////////////////////////////////////////////////////////
+void jsImpl::startSynthetic(const std::vector<js::SyntheticDevice> &devices, unsigned int seed)
+{
+    stopReplay();
+    stopSynthetic();
+
+    const auto count = std::min<std::size_t>(devices.size(), js::max_nJoystick);
+
+    slots.assign(count, jsSyntheticSlot());
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        jsSyntheticSlot &slot = slots[i];
+        const js::SyntheticDevice &config = devices[i];
+
+        slot.config = config;
+        slot.caps.nButton = std::min<unsigned int>(config.nButton, js::max_nButton);
+        slot.caps.nPOV = std::min<unsigned int>(config.nPOV, js::max_nPOV);
+        for (unsigned int a = 0; a < js::max_nAxis; ++a)
+            slot.caps.axes[a] = a < config.nAxis;
+        slot.id.name = L"Synthetic joystick " + std::to_wstring(i);
+        slot.id.vendorId = 0xFFFF;
+        slot.id.productId = static_cast<unsigned int>(i);
+
+        // every joystick has its own sequence of random numbers, independent of the others
+        slot.random.seed(seed + static_cast<unsigned int>(i));
+
+        // only controls the joystick has contribute to the rate
+        double rate = 0.0;
+        if (slot.caps.nButton > 0)
+            rate += std::max(config.buttonRate, 0.f);
+        if (config.nAxis > 0)
+            rate += std::max(config.axisRate, 0.f);
+        if (slot.caps.nPOV > 0)
+            rate += std::max(config.povRate, 0.f);
+        if (config.pattern == js::SyntheticDevice::Bursty)
+            rate /= std::max(config.burstLength, 1u);
+        slot.rate = rate;
+
+        if (!config.script.empty())
+        {
+            slot.loopLength = std::max<Clock::duration>(config.script.back().time.time_since_epoch(),
+                                                        std::chrono::milliseconds(1));
+        }
+        else if (config.pattern == js::SyntheticDevice::Scripted)
+        {
+            slot.config.pattern = js::SyntheticDevice::Random;
+            slot.rate = 0.0;
+        }
+    }
+
+    setBackend(jsBackend::Synthetic);
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::stopSynthetic()
+{
+    if (getBackend() != jsBackend::Synthetic)
+        return;
+
+    slots.clear();
+
+    setBackend(jsBackend::Platform);
+}
+
+////////////////////////////////////////////////////////////
+std::uint32_t jsImpl::connectedMaskSynthetic()
+{
+    return static_cast<std::uint32_t>((std::uint64_t{1} << slots.size()) - 1);
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::prepareUpdateSynthetic()
+{
+    now = Clock::now();
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::waitForInputSynthetic(std::chrono::milliseconds timeout)
+{
+    const auto deadline = Clock::now() + timeout;
+    auto due = Clock::time_point::max();
+
+    for (const jsSyntheticSlot &slot : slots)
+        due = std::min(due, slot.next);
+
+    // sleep until the next change of any joystick is due
+    std::this_thread::sleep_until(std::min(due, deadline));
+
+    return due <= deadline;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::openSynthetic(unsigned int index)
+{
+    if (index >= slots.size())
+        return false;
+
+    jsSyntheticSlot &slot = slots[index];
+
+    m_index = index;
+    m_identification = slot.id;
+    m_resync = true;
+    m_buffered = true;
+    m_overflowCount = 0;
+
+    // input starts when the joystick is opened
+    const auto start = Clock::now();
+    slot.loopStart = start;
+    slot.scriptIndex = 0;
+    slot.next = nextTime(slot, start);
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+void jsImpl::closeSynthetic()
+{
+}
+
+////////////////////////////////////////////////////////////
+jsCaps jsImpl::getCapabilitiesSynthetic() const
+{
+    return slots[m_index].caps;
+}
+
+////////////////////////////////////////////////////////////
+bool jsImpl::updateSynthetic(jsState &state, const jsState &current, std::vector<js::Event> &events)
+{
+    bool written = false;
+
+    // The new state is the current one plus the generated changes: copy it only if there are any
+    auto beginWrite = [&]() {
+        if (!written)
+        {
+            state = current;
+            state.connected = true;
+            written = true;
+        }
+    };
+
+    // after open: the generated changes start from a neutral state
+    if (m_resync)
+    {
+        beginWrite();
+        m_resync = false;
+    }
+
+    jsSyntheticSlot &slot = slots[m_index];
+
+    if (slot.next > now)
+        return written;
+
+    // not updated for too long: drop the input that would have been generated meanwhile, like a device buffer overflow
+    if (now - slot.next > maxBacklog)
+    {
+        ++m_overflowCount;
+
+        if (slot.config.pattern == js::SyntheticDevice::Scripted)
+        {
+            // skip complete loops of the script
+            slot.loopStart += ((now - maxBacklog - slot.loopStart) / slot.loopLength) * slot.loopLength;
+            slot.scriptIndex = 0;
+            slot.next = nextTime(slot, slot.next);
+        }
+        else
+            slot.next = now - maxBacklog;
+    }
+
+    const js::SyntheticDevice &config = slot.config;
+    const unsigned int nAxis = std::min<unsigned int>(config.nAxis, js::max_nAxis);
+
+    // apply a change and report it
+    auto change = [&](jsControl control, int value, js::axis_t axisValue, Clock::time_point time) {
+        switch (control.kind)
+        {
+        case jsControl::Axis:
+            state.axes[control.index] = axisValue;
+            break;
+        case jsControl::Pov:
+            state.povs[control.index] = value;
+            break;
+        default:
+            state.buttons.set(control.index, value != 0);
+            break;
+        }
+
+        events.push_back(makeEvent(state, control, time, m_sequence));
+    };
+
+    // a random change: control weighted by the rates, random button toggled, random axis/pov position
+    auto randomChange = [&](Clock::time_point time) {
+        const float buttonRate = (slot.caps.nButton > 0) ? std::max(config.buttonRate, 0.f) : 0.f;
+        const float axisRate = (nAxis > 0) ? std::max(config.axisRate, 0.f) : 0.f;
+        const float povRate = (slot.caps.nPOV > 0) ? std::max(config.povRate, 0.f) : 0.f;
+        const float pick = std::uniform_real_distribution<float>(0.f, buttonRate + axisRate + povRate)(slot.random);
+
+        if (pick < buttonRate)
+        {
+            const auto index = std::uniform_int_distribution<unsigned int>(0, slot.caps.nButton - 1)(slot.random);
+            change({jsControl::Button, static_cast<unsigned char>(index)}, !state.buttons.test(index), js::axis_t{}, time);
+        }
+        else if (pick < buttonRate + axisRate)
+        {
+            const auto index = std::uniform_int_distribution<unsigned int>(0, nAxis - 1)(slot.random);
+            change({jsControl::Axis, static_cast<unsigned char>(index)}, 0,
+                   js::axisFromPercent(std::uniform_real_distribution<float>(-100.f, 100.f)(slot.random)), time);
+        }
+        else
+        {
+            const auto index = std::uniform_int_distribution<unsigned int>(0, slot.caps.nPOV - 1)(slot.random);
+            const int position = std::uniform_int_distribution<int>(-1, 7)(slot.random);
+            change({jsControl::Pov, static_cast<unsigned char>(index)}, (position < 0) ? -1 : position * 4500, js::axis_t{}, time);
+        }
+    };
+
+    while (slot.next <= now)
+    {
+        const Clock::time_point time = slot.next;
+
+        beginWrite();
+        ++m_sequence;
+
+        switch (config.pattern)
+        {
+        case js::SyntheticDevice::Random:
+            randomChange(time);
+            break;
+
+        case js::SyntheticDevice::Bursty:
+            for (unsigned int i = 0; i < std::max(config.burstLength, 1u); ++i)
+                randomChange(time);
+            break;
+
+        case js::SyntheticDevice::Scripted:
+            // events of the script at the same time were reported together
+            for (; (slot.scriptIndex < config.script.size()) &&
+                   (slot.loopStart + config.script[slot.scriptIndex].time.time_since_epoch() == time);
+                 ++slot.scriptIndex)
+            {
+                const js::Event &event = config.script[slot.scriptIndex];
+
+                switch (event.type)
+                {
+                case js::Event::AxisMoved:
+                    if ((event.index < js::max_nAxis) && slot.caps.axes[event.index])
+                        change({jsControl::Axis, event.index}, 0, std::clamp<js::axis_t>(event.axisPosition, -js::axisFull, js::axisFull), time);
+                    break;
+                case js::Event::PovMoved:
+                    if (event.index < slot.caps.nPOV)
+                        change({jsControl::Pov, event.index}, event.position, js::axis_t{}, time);
+                    break;
+                default:
+                    if (event.index < slot.caps.nButton)
+                        change({jsControl::Button, event.index}, event.type == js::Event::ButtonPressed, js::axis_t{}, time);
+                    break;
+                }
+            }
+            break;
+        }
+
+        slot.next = nextTime(slot, time);
+    }
+
+    return written;
+}
+
+} // namespace priv
+
+} // namespace hd
@@ -36,6 +36,70 @@
 
 #include "di8joy_mngr.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <future>
+#include <type_traits>
+
+namespace
+{
+
+// anonymous namespace for things to be kept private to this translation unit
+
+// max. time waitForInput() waits while filtered axes are settling
+constexpr std::chrono::milliseconds settleInterval{10};
+
+// max. time waitForInput() waits while joysticks are opened on worker threads
+constexpr std::chrono::milliseconds openingInterval{5};
+
+// The published buffers are copied by readers while update() may already overwrite them
+// (the sequence lock discards such copies): every access to them is a relaxed atomic one,
+// which costs plain loads and stores but keeps the concurrent copy from being a data race
+template <typename T>
+T loadRelaxed(const T &value)
+{
+    return std::atomic_ref<T>(const_cast<T &>(value)).load(std::memory_order_relaxed);
+}
+
+template <typename T>
+void storeRelaxed(T &value, T desired)
+{
+    std::atomic_ref<T>(value).store(desired, std::memory_order_relaxed);
+}
+
+template <typename T, std::size_t N>
+void loadRelaxed(T (&copy)[N], const T (&values)[N])
+{
+    for (std::size_t i = 0; i < N; ++i)
+        copy[i] = loadRelaxed(values[i]);
+}
+
+template <typename T, std::size_t N>
+void storeRelaxed(T (&values)[N], const T (&desired)[N])
+{
+    for (std::size_t i = 0; i < N; ++i)
+        storeRelaxed(values[i], desired[i]);
+}
+
+hd::priv::jsCaps loadRelaxed(const hd::priv::jsCaps &caps)
+{
+    hd::priv::jsCaps copy;
+    copy.nButton = loadRelaxed(caps.nButton);
+    copy.nPOV = loadRelaxed(caps.nPOV);
+    loadRelaxed(copy.axes, caps.axes);
+    return copy;
+}
+
+void storeRelaxed(hd::priv::jsCaps &caps, const hd::priv::jsCaps &desired)
+{
+    storeRelaxed(caps.nButton, desired.nButton);
+    storeRelaxed(caps.nPOV, desired.nPOV);
+    storeRelaxed(caps.axes, desired.axes);
+}
+
+} // anonymous namespace
+
 namespace hd
 {
 namespace priv
@@ -47,71 +111,595 @@ jsMngr &jsMngr::getInstance()
     return instance;
 }
 
-const jsCaps &jsMngr::getCapabilities(unsigned int jsIdx) const
+template <typename Read>
+auto jsMngr::readConsistent(unsigned int jsIdx, Read read) const
+{
+    const std::atomic<std::uint64_t> &generation = m_hot.generation[jsIdx];
+
+    for (;;)
+    {
+        const std::uint64_t seen = generation.load(std::memory_order_acquire);
+
+        const auto copy = read(static_cast<unsigned int>(seen & 1));
+        static_assert(std::is_trivially_copyable_v<decltype(copy)>);
+
+        // the copy is only valid if no new generation was published while copying,
+        // the fence keeps the check from being reordered before the copy
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (generation.load(std::memory_order_relaxed) == seen)
+            return copy;
+    }
+}
+
+void jsMngr::publish(unsigned int jsIdx, const jsState &state)
+{
+    const std::uint64_t generation = m_hot.generation[jsIdx].load(std::memory_order_relaxed);
+    const auto back = static_cast<unsigned int>((generation + 1) & 1);
+
+    // The back buffer may still be copied by a reader that loaded the previous generation:
+    // make sure such a reader sees the current generation once it sees any of our writes
+    std::atomic_thread_fence(std::memory_order_release);
+
+    js::axis_t axes[js::max_nAxis];
+    std::memcpy(axes, state.axes, sizeof(axes));
+    if (m_axes.isActive(jsIdx))
+        m_axes.apply(jsIdx, axes);
+
+    storeRelaxed(m_joysticks[jsIdx].capabilities[back], m_joysticks[jsIdx].caps);
+    storeRelaxed(m_hot.connected[back][jsIdx], state.connected);
+    storeRelaxed(m_hot.buttons[back][jsIdx].bits, state.buttons.bits);
+    storeRelaxed(m_hot.axes[back][jsIdx], axes);
+    storeRelaxed(m_hot.povs[back][jsIdx], state.povs);
+
+    // Publish: the back buffer becomes the front buffer
+    m_hot.generation[jsIdx].store(generation + 1, std::memory_order_release);
+}
+
+jsCaps jsMngr::getCapabilities(unsigned int jsIdx) const
+{
+    return readConsistent(jsIdx, [&](unsigned int front) { return loadRelaxed(m_joysticks[jsIdx].capabilities[front]); });
+}
+
+jsState jsMngr::getState(unsigned int jsIdx) const
+{
+    return readConsistent(jsIdx, [&](unsigned int front) {
+        jsState state;
+        state.connected = loadRelaxed(m_hot.connected[front][jsIdx]);
+        loadRelaxed(state.buttons.bits, m_hot.buttons[front][jsIdx].bits);
+        loadRelaxed(state.axes, m_hot.axes[front][jsIdx]);
+        loadRelaxed(state.povs, m_hot.povs[front][jsIdx]);
+        return state;
+    });
+}
+
+bool jsMngr::isConnected(unsigned int jsIdx) const
+{
+    return readConsistent(jsIdx, [&](unsigned int front) { return loadRelaxed(m_hot.connected[front][jsIdx]); });
+}
+
+bool jsMngr::isButtonPressed(unsigned int jsIdx, unsigned int buttonIdx) const
 {
-    return m_joysticks[jsIdx].capabilities;
+    return readConsistent(jsIdx, [&](unsigned int front) {
+        return ((loadRelaxed(m_hot.buttons[front][jsIdx].bits[buttonIdx / 64]) >> (buttonIdx % 64)) & 1u) != 0;
+    });
 }
 
-const jsState &jsMngr::getState(unsigned int jsIdx) const
+int jsMngr::getPovPosition(unsigned int jsIdx, unsigned int povIdx) const
 {
-    return m_joysticks[jsIdx].state;
+    return readConsistent(jsIdx, [&](unsigned int front) { return loadRelaxed(m_hot.povs[front][jsIdx][povIdx]); });
 }
 
-const js::Id &jsMngr::getId(unsigned int jsIdx) const
+js::axis_t jsMngr::getAxisPosition(unsigned int jsIdx, js::Axis axisIdx) const
 {
+    return readConsistent(jsIdx, [&](unsigned int front) { return loadRelaxed(m_hot.axes[front][jsIdx][axisIdx]); });
+}
+
+std::uint64_t jsMngr::getGeneration(unsigned int jsIdx) const
+{
+    return m_hot.generation[jsIdx].load(std::memory_order_acquire);
+}
+
+js::Id jsMngr::getId(unsigned int jsIdx) const
+{
+    std::lock_guard<std::mutex> lock(m_idMutex);
     return m_joysticks[jsIdx].identification;
 }
 
-void jsMngr::update()
+unsigned int jsMngr::getOverflowCount(unsigned int jsIdx) const
+{
+    return m_joysticks[jsIdx].joystick.getOverflowCount();
+}
+
+const js::ButtonEdges &jsMngr::getButtonEdges(unsigned int jsIdx) const
+{
+    static const js::ButtonEdges noEdges;
+
+    // edges are only valid for the update() that computed them
+    return m_hot.edgesUpdate[jsIdx] == m_updateCount ? m_hot.edges[jsIdx] : noEdges;
+}
+
+const std::vector<js::Event> &jsMngr::getEvents(unsigned int jsIdx) const
+{
+    static const std::vector<js::Event> noEvents;
+
+    // events are only valid for the update() that collected them
+    const jsDevice &device = m_joysticks[jsIdx];
+    return device.eventsUpdate == m_updateCount ? device.events : noEvents;
+}
+
+bool jsMngr::pollEvent(js::Event &event)
+{
+    m_eventsEnabled.store(true, std::memory_order_relaxed);
+    return m_events.pop(event);
+}
+
+bool jsMngr::waitEvent(js::Event &event, std::chrono::milliseconds timeout)
+{
+    if (pollEvent(event))
+        return true;
+
+    // Register as waiter before checking the queue again: either update() sees the
+    // waiter and signals, or the check under the lock sees the events it queued
+    m_eventWaiters.fetch_add(1, std::memory_order_seq_cst);
+
+    bool popped;
+    {
+        std::unique_lock<std::mutex> lock(m_eventMutex);
+        popped = m_eventSignal.wait_for(lock, timeout, [&] { return m_events.pop(event); });
+    }
+
+    m_eventWaiters.fetch_sub(1, std::memory_order_relaxed);
+
+    return popped;
+}
+
+unsigned int jsMngr::getDroppedEventCount() const
+{
+    return m_events.getDroppedCount();
+}
+
+void jsMngr::setAxisResponse(unsigned int jsIdx, js::Axis axisIdx, const js::AxisResponse &response)
+{
+    m_axes.set(jsIdx, axisIdx, response);
+    m_reconditionMask |= 1u << jsIdx;
+}
+
+js::AxisResponse jsMngr::getAxisResponse(unsigned int jsIdx, js::Axis axisIdx) const
+{
+    return m_axes.get(jsIdx, axisIdx);
+}
+
+void jsMngr::setAxisFilter(unsigned int jsIdx, js::Axis axisIdx, const js::AxisFilter &filter)
+{
+    m_filters.set(jsIdx, axisIdx, filter);
+    m_reconditionMask |= 1u << jsIdx;
+}
+
+js::AxisFilter jsMngr::getAxisFilter(unsigned int jsIdx, js::Axis axisIdx) const
+{
+    return m_filters.get(jsIdx, axisIdx);
+}
+
+bool jsMngr::waitForInput(std::chrono::milliseconds timeout)
+{
+    initialize();
+
+    // A disconnect seen by the last update() has not been rescanned yet
+    if (m_rescan)
+        return true;
+
+    // Joysticks being opened on worker threads go live with the next update() after their open
+    if (m_openingMask != 0)
+    {
+        jsImpl::waitForInput(std::min(timeout, openingInterval));
+        return true;
+    }
+
+    // Filtered axes that are still settling move without input
+    if ((m_filters.getSettlingMask() & m_openMask) != 0)
+    {
+        jsImpl::waitForInput(std::min(timeout, settleInterval));
+        return true;
+    }
+
+    return jsImpl::waitForInput(timeout);
+}
+
+bool jsMngr::startRecording(const std::string &path)
+{
+    if (!m_recorder.start(path))
+        return false;
+
+    // Joysticks open already: record them as connected with their current state
+    for (std::uint32_t remaining = m_openMask; remaining != 0; remaining &= remaining - 1)
+    {
+        const auto i = static_cast<unsigned int>(std::countr_zero(remaining));
+        const jsDevice &device = m_joysticks[i];
+
+        std::vector<js::Event> events;
+        appendChangeEvents(events, jsState(), device.current, js::Event::Clock::now(), 0);
+        for (js::Event &event : events)
+            event.joystick = static_cast<unsigned char>(i);
+
+        m_recorder.recordConnect(i, device.caps, device.joystick.getId());
+        m_recorder.record(events, device.caps.nButton);
+    }
+
+    m_recorder.flush();
+
+    return true;
+}
+
+void jsMngr::stopRecording()
+{
+    m_recorder.stop();
+}
+
+bool jsMngr::startReplay(const std::string &path, bool realTime)
+{
+    closeAll();
+
+    return jsImpl::startReplay(path, realTime);
+}
+
+void jsMngr::stopReplay()
+{
+    if (!jsImpl::isReplaying())
+        return;
+
+    closeAll();
+    jsImpl::stopReplay();
+}
+
+bool jsMngr::isReplaying() const
+{
+    return jsImpl::isReplaying() && !jsImpl::isReplayFinished();
+}
+
+void jsMngr::startSynthetic(const std::vector<js::SyntheticDevice> &devices, unsigned int seed)
+{
+    closeAll();
+
+    jsImpl::startSynthetic(devices, seed);
+}
+
+void jsMngr::stopSynthetic()
 {
-    for (unsigned int i = 0; i < js::max_nJoystick; ++i)
+    if (jsImpl::getBackend() != jsBackend::Synthetic)
+        return;
+
+    closeAll();
+    jsImpl::stopSynthetic();
+}
+
+bool jsMngr::setProfileFile(const std::string &path)
+{
+    return jsImpl::setProfileFile(path);
+}
+
+void jsMngr::closeAll()
+{
+    finishOpening();
+
+    for (std::uint32_t remaining = m_openMask; remaining != 0; remaining &= remaining - 1)
     {
+        const auto i = static_cast<unsigned int>(std::countr_zero(remaining));
         jsDevice &device = m_joysticks[i];
 
-        if (device.state.connected)
+        device.joystick.close();
+        device.caps = jsCaps();
         {
-            // Get the current state of the joystick
-            device.state = device.joystick.update();
+            std::lock_guard<std::mutex> lock(m_idMutex);
+            device.identification = js::Id();
+        }
+        device.current = jsState();
+        device.published = jsState();
 
-            // Check if it's still connected
-            if (!device.state.connected)
-            {
-                device.joystick.close();
-                device.capabilities = jsCaps();
-                device.state = jsState();
-                device.identification = js::Id();
-            }
+        if (m_recorder.isRecording())
+            m_recorder.recordDisconnect(i);
+
+        publish(i, device.published);
+    }
+
+    m_openMask = 0;
+    m_rescan = true;
+}
+
+void jsMngr::update()
+{
+    initialize();
+
+    ++m_updateCount;
+
+    // Let the backend fetch the pending input of all joysticks at once
+    jsImpl::prepareUpdate();
+
+    // Rescan only if the hotplug watcher reported a change or a joystick went away,
+    // plugged in joysticks that are not open yet are opened after a rescan only.
+    // No rescan while joysticks are opened on worker threads: they read the connection cache.
+    std::uint32_t toOpen = 0;
+
+    if ((m_rescan || jsImpl::hasConnectionChanges()) && (m_openingMask == 0))
+    {
+        jsImpl::updateConnections();
+        m_rescan = false;
+        toOpen = jsImpl::getConnectedMask() & ~m_openMask;
+
+        if (!m_startupScanned)
+        {
+            m_startupScanned = true;
+            m_startupMask = toOpen;
+            trackStartup(0, false);
+        }
+    }
+
+    // Opening a joystick of the platform takes several round trips to the driver: all of them
+    // are opened concurrently on worker threads, each one goes live with the first update()
+    // after its open completed, update() does not wait for them
+    if ((toOpen != 0) && (jsImpl::getBackend() == jsBackend::Platform))
+    {
+        for (std::uint32_t remaining = toOpen; remaining != 0; remaining &= remaining - 1)
+        {
+            const auto i = static_cast<unsigned int>(std::countr_zero(remaining));
+            jsImpl &joystick = m_joysticks[i].joystick;
+            m_joysticks[i].opening = std::async(std::launch::async, [&joystick, i] { return joystick.open(i); });
+        }
+
+        m_openingMask |= toOpen;
+        toOpen = 0;
+    }
+
+    std::uint32_t opened = 0; // opened on a worker thread, to go live now
+
+    for (std::uint32_t remaining = m_openingMask; remaining != 0; remaining &= remaining - 1)
+    {
+        const auto i = static_cast<unsigned int>(std::countr_zero(remaining));
+        const std::uint32_t bit = 1u << i;
+        std::future<bool> &opening = m_joysticks[i].opening;
+
+        if (opening.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+
+        m_openingMask &= ~bit;
+
+        if (opening.get())
+            opened |= bit;
+        else
+            trackStartup(bit, false);
+    }
+
+    const bool queueEvents = m_eventsEnabled.load(std::memory_order_relaxed);
+    const bool recording = m_recorder.isRecording();
+    bool queued = false;
+
+    // Visit open and newly plugged joysticks only, empty slots cost nothing
+    // Scratch buffer the joysticks write their new state into, published only if it changed
+    jsState next;
+
+    // Time of the samples of filtered axes without input
+    const js::Event::Clock::time_point now = m_filters.any() ? js::Event::Clock::now() : js::Event::Clock::time_point();
+
+    for (std::uint32_t pending = m_openMask | toOpen | opened; pending != 0; pending &= pending - 1)
+    {
+        const auto i = static_cast<unsigned int>(std::countr_zero(pending));
+        const std::uint32_t bit = 1u << i;
+
+        jsDevice &device = m_joysticks[i];
+        bool written = false;
+        bool capsChanged = false;
+        bool disconnected = false;
+        unsigned int nButton = device.caps.nButton; // physical buttons, also of a joystick disconnected meanwhile
+
+        device.events.clear();
+
+        if (m_openMask & bit)
+        {
+            // Let the joystick write its new state into next (if there was any input)
+            written = device.joystick.update(next, device.current, device.events);
         }
         else
         {
-            // Check if the joystick was connected since last update
-            if (jsImpl::isConnected(i))
+            // The joystick was plugged in since last rescan (and opened on a worker thread already)
+            if ((opened & bit) || device.joystick.open(i))
             {
-                if (device.joystick.open(i))
+                device.caps = device.joystick.getCapabilities();
+                capsChanged = true;
                 {
-                    device.capabilities = device.joystick.getCapabilities();
-                    device.state = device.joystick.update();
+                    std::lock_guard<std::mutex> lock(m_idMutex);
                     device.identification = device.joystick.getId();
                 }
+                m_openMask |= bit;
+                nButton = device.caps.nButton;
+
+                if (recording)
+                    m_recorder.recordConnect(i, device.caps, device.joystick.getId());
+
+                next = jsState(); // no leftovers of a joystick previously connected to this slot
+                m_filters.reset(i);
+                written = device.joystick.update(next, device.current, device.events);
+                trackStartup(bit, true);
+            }
+            else
+            {
+                trackStartup(bit, false);
+            }
+        }
+
+        // Check if it's still connected
+        if (written && !next.connected)
+        {
+            device.joystick.close();
+            disconnected = true;
+            m_openMask &= ~bit;
+            m_rescan = true; // drop it from the connection cache, a successor on the same node is opened again
+            device.caps = jsCaps();
+            capsChanged = true;
+            {
+                std::lock_guard<std::mutex> lock(m_idMutex);
+                device.identification = js::Id();
             }
+            next = jsState();
+        }
+
+        for (js::Event &event : device.events)
+            event.joystick = static_cast<unsigned char>(i);
+
+        // Recordings hold the unfiltered positions and no virtual buttons, like the backends deliver them
+        if (recording && !device.events.empty())
+            m_recorder.record(device.events, nButton);
+
+        // The backend continues from the unfiltered state including the virtual pov buttons,
+        // a changed filter or conditioning is applied to it again
+        if (written)
+        {
+            const std::size_t backendEvents = device.events.size();
+
+            applyPovButtons(next, device.current, device.caps, device.events);
+            for (std::size_t e = backendEvents; e < device.events.size(); ++e)
+                device.events[e].joystick = static_cast<unsigned char>(i);
+
+            device.current = next;
+        }
+        else if ((m_reconditionMask & bit) && (m_openMask & bit))
+        {
+            next = device.current;
+            written = true;
+        }
+
+        // Filtered axes report their filtered positions, also without input while they are settling
+        if (m_filters.isActive(i) && (m_openMask & bit))
+        {
+            if (!written && ((m_filters.getSettlingMask() & bit) != 0))
+            {
+                next = device.current;
+                written = true;
+            }
+
+            if (written)
+                m_filters.apply(i, device.published.axes, next.axes, device.events, now);
+        }
+
+        // Presses and releases within one update cancel out in the edges, but not in the events
+        if (!device.events.empty())
+        {
+            device.eventsUpdate = m_updateCount;
+
+            const bool conditioned = m_axes.isActive(i);
+
+            for (js::Event &event : device.events)
+            {
+                if (conditioned && (event.type == js::Event::AxisMoved))
+                    event.axisPosition = m_axes.apply(i, event.index, event.axisPosition);
+
+                if (queueEvents)
+                    queued |= m_events.push(event);
+            }
+        }
+
+        if (disconnected && recording)
+            m_recorder.recordDisconnect(i);
+
+        if (!written || (next == device.published))
+        {
+            // Changed capabilities or conditioning without a new state are published nevertheless
+            if (capsChanged || (m_reconditionMask & bit))
+                publish(i, device.published);
+
+            continue;
+        }
+
+        // Edges: changed buttons that are on now were pressed, changed buttons that were on before were released
+        const js::ButtonMask changed = device.published.buttons ^ next.buttons;
+        m_hot.edges[i].pressed = changed & next.buttons;
+        m_hot.edges[i].released = changed & device.published.buttons;
+        m_hot.edgesUpdate[i] = m_updateCount;
+
+        device.published = next;
+        publish(i, device.published);
+    }
+
+    m_reconditionMask = 0;
+
+    if (recording)
+        m_recorder.flush();
+
+    // Wake up waitEvent(), the lock is only taken if somebody waits
+    if (queued)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (m_eventWaiters.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_eventMutex);
+            m_eventSignal.notify_all();
         }
     }
 }
 
-jsMngr::jsMngr()
+js::StartupTimes jsMngr::getStartupTimes() const
+{
+    return m_startup;
+}
+
+void jsMngr::initialize()
 {
+    if (m_initialized)
+        return;
+
+    // The backends are initialized by the first update() or waitForInput(), not by the
+    // first use of the library
+    m_initialized = true;
+    m_startTime = std::chrono::steady_clock::now();
+
     jsImpl::initialize();
 }
 
-jsMngr::~jsMngr()
+void jsMngr::finishOpening()
 {
-    for (jsDevice &device : m_joysticks)
+    for (std::uint32_t remaining = m_openingMask; remaining != 0; remaining &= remaining - 1)
     {
-        if (device.state.connected)
-            device.joystick.close();
+        const auto i = static_cast<unsigned int>(std::countr_zero(remaining));
+
+        if (m_joysticks[i].opening.get())
+            m_joysticks[i].joystick.close();
+
+        trackStartup(1u << i, false);
     }
 
-    jsImpl::cleanup();
+    m_openingMask = 0;
+}
+
+void jsMngr::trackStartup(std::uint32_t bit, bool live)
+{
+    if (!(m_startupMask & bit) && (bit != 0))
+        return;
+
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_startTime);
+
+    if (live && (m_startup.firstLive.count() < 0))
+        m_startup.firstLive = elapsed;
+
+    m_startupMask &= ~bit;
+
+    if ((m_startupMask == 0) && (m_startup.allLive.count() < 0))
+        m_startup.allLive = elapsed;
+}
+
+jsMngr::jsMngr()
+{
+}
+
+jsMngr::~jsMngr()
+{
+    finishOpening();
+
+    for (std::uint32_t remaining = m_openMask; remaining != 0; remaining &= remaining - 1)
+        m_joysticks[std::countr_zero(remaining)].joystick.close();
+
+    if (m_initialized)
+        jsImpl::cleanup();
 }
 
 } // namespace priv
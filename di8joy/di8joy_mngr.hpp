@@ -38,23 +38,109 @@
 #define DI8JOY_MNGR_HPP
 
 #include "di8joy.hpp"
+#include "di8joy_axis.hpp"
 #include "di8joy_impl.hpp"
+#include "di8joy_queue.hpp"
+#include "di8joy_record.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace hd
 {
 namespace priv
 {
 
+// The joystick states are published by update() and may be read from any thread:
+//
+// Each device has a front and a back buffer for its state, the front buffer is
+// buffer generation & 1. update() writes the new state into the back buffer and
+// publishes it by incrementing generation. Readers use generation as a sequence lock:
+// they copy the front buffer and retry if generation changed meanwhile (the buffer
+// could have been reused as back buffer then). Both sides access the buffers with
+// relaxed atomic loads and stores only. Readers never block update() and update()
+// never waits for readers.
+//
+// The capabilities of a device are double buffered and published together with the
+// state under the same sequence lock, the identification holds a std::wstring and
+// is guarded by a mutex that update() only takes when a device connects or disconnects.
+//
+// The buffers and generations are not part of the device but kept in a struct of arrays
+// for all devices (jsHotStore): scanning e.g. the buttons or generations of all devices
+// touches a few cache lines only, the cold data of a device (backend, capabilities,
+// identification) is not dragged through the cache.
+//
+// The events of all joysticks are additionally queued for pollEvent()/waitEvent(), but
+// only once one of them has been called: consumers of the snapshots pay nothing for it.
+
 class jsMngr
 {
   public:
     static jsMngr &getInstance();
 
-    const jsCaps &getCapabilities(unsigned int jd_idx) const;
+    jsCaps getCapabilities(unsigned int js_idx) const; // consistent snapshot, safe from any thread
+
+    jsState getState(unsigned int js_idx) const; // consistent snapshot, safe from any thread
+
+    std::uint64_t getGeneration(unsigned int js_idx) const;
+
+    js::Id getId(unsigned int js_idx) const;
+
+    unsigned int getOverflowCount(unsigned int js_idx) const;
+
+    bool isConnected(unsigned int js_idx) const; // single controls of the state, safe from any thread
+
+    bool isButtonPressed(unsigned int js_idx, unsigned int buttonIdx) const;
+
+    int getPovPosition(unsigned int js_idx, unsigned int povIdx) const;
+
+    js::axis_t getAxisPosition(unsigned int js_idx, js::Axis axisIdx) const;
+
+    const js::ButtonEdges &getButtonEdges(unsigned int js_idx) const; // only valid in the thread calling update()
+
+    const std::vector<js::Event> &getEvents(unsigned int js_idx) const; // only valid in the thread calling update()
+
+    bool pollEvent(js::Event &event); // one consumer thread
+
+    bool waitEvent(js::Event &event, std::chrono::milliseconds timeout); // one consumer thread
+
+    unsigned int getDroppedEventCount() const;
+
+    // only from the thread calling update()
+    void setAxisResponse(unsigned int js_idx, js::Axis axisIdx, const js::AxisResponse &response);
 
-    const jsState &getState(unsigned int js_idx) const;
+    js::AxisResponse getAxisResponse(unsigned int js_idx, js::Axis axisIdx) const;
 
-    const js::Id &getId(unsigned int js_idx) const;
+    // only from the thread calling update()
+    void setAxisFilter(unsigned int js_idx, js::Axis axisIdx, const js::AxisFilter &filter);
+
+    js::AxisFilter getAxisFilter(unsigned int js_idx, js::Axis axisIdx) const;
+
+    bool waitForInput(std::chrono::milliseconds timeout); // only from the thread calling update()
+
+    bool startRecording(const std::string &path);
+
+    void stopRecording();
+
+    bool startReplay(const std::string &path, bool realTime);
+
+    void stopReplay();
+
+    bool isReplaying() const;
+
+    void startSynthetic(const std::vector<js::SyntheticDevice> &devices, unsigned int seed);
+
+    void stopSynthetic();
+
+    bool setProfileFile(const std::string &path);
+
+    js::StartupTimes getStartupTimes() const; // only from the thread calling update()
 
     void update();
 
@@ -64,15 +150,65 @@ class jsMngr
     jsMngr(const jsMngr &) = delete;
     jsMngr &operator=(const jsMngr &) = delete;
 
-    struct jsDevice
+    struct jsDevice // cold data of a joystick and data used by update() only
     {
-        jsImpl joystick;       // Joystick implementation
-        jsState state;         // Current joystick state
-        jsCaps capabilities;   // Joystick capabilities
-        js::Id identification; // Joystick identification
+        jsImpl joystick;                // Joystick implementation
+        jsState current;                // Unfiltered state, for update() and the backend
+        jsState published;              // State as published last (filtered, not conditioned)
+        jsCaps caps;                    // Capabilities as published with the next state, for update()
+        jsCaps capabilities[2];         // Front and back buffer of the capabilities (same generation as the state)
+        js::Id identification;          // Joystick identification (guarded by m_idMutex)
+        std::vector<js::Event> events;  // Control changes of update number eventsUpdate
+        std::uint64_t eventsUpdate = 0; // update() that collected events, older events are empty
+        std::future<bool> opening;      // open() running on a worker thread (bit set in m_openingMask)
     };
 
-    jsDevice m_joysticks[js::max_nJoystick]; // Joysticks information and state
+    struct jsHotStore // data of all joysticks read every tick, struct of arrays indexed [buffer][joystick]
+    {
+        std::atomic<std::uint64_t> generation[js::max_nJoystick]{};    // Published state changes, selects the front buffer
+        alignas(64) bool connected[2][js::max_nJoystick]{};            // Front and back buffer of the connection state
+        alignas(64) js::ButtonMask buttons[2][js::max_nJoystick]{};    // Front and back buffer of the buttons
+        alignas(64) js::axis_t axes[2][js::max_nJoystick][js::max_nAxis]{}; // Front and back buffer of the axes
+        alignas(64) int povs[2][js::max_nJoystick][js::max_nPOV]{};    // Front and back buffer of the pov hats
+        alignas(64) js::ButtonEdges edges[js::max_nJoystick]{};        // Buttons pressed/released by update edgesUpdate
+        std::uint64_t edgesUpdate[js::max_nJoystick]{};                // update() that computed edges, older are empty
+    };
+
+    template <typename Read>
+    auto readConsistent(unsigned int jsIdx, Read read) const; // sequence lock read: read(front buffer) of joystick jsIdx
+
+    void publish(unsigned int jsIdx, const jsState &state); // write state (conditioned) and caps into the back
+                                                            // buffers, then make them the front buffers
+
+    void closeAll(); // close and publish all open joysticks as disconnected (when switching the backend)
+
+    void initialize(); // initialize the backends with the first update() or waitForInput()
+
+    void finishOpening(); // wait for the opens running on worker threads and close the joysticks they opened
+
+    void trackStartup(std::uint32_t bit, bool live); // joysticks of bit found at startup went live or failed to open
+
+    jsHotStore m_hot;                            // Published state of all joysticks
+    jsDevice m_joysticks[js::max_nJoystick];     // Joysticks information
+    mutable std::mutex m_idMutex;                // Guards the identification of all joysticks
+    std::uint32_t m_openMask = 0;                // bit i set: joystick i is open
+    std::uint64_t m_updateCount = 0;             // Number of update() calls
+    bool m_rescan = true;                        // Rescan at the next update() (first update, joystick disconnected)
+    jsEventQueue m_events;                       // Events of all joysticks, filled by update() once enabled
+    std::atomic<bool> m_eventsEnabled{false};    // pollEvent() or waitEvent() has been called
+    std::atomic<unsigned int> m_eventWaiters{0}; // Number of threads blocked in waitEvent()
+    std::mutex m_eventMutex;                     // Guards the wakeup of waitEvent()
+    std::condition_variable m_eventSignal;       // Signaled by update() when it queued events for a waiter
+    jsRecorder m_recorder;                       // Records the events of all joysticks if started
+    jsAxisFilter m_filters;                      // Noise filters of the axis positions
+    jsAxisConditioner m_axes;                    // Conditioning of the axis positions
+    std::uint32_t m_reconditionMask = 0;         // bit i set: publish joystick i again, its filter or conditioning changed
+    std::uint32_t m_openingMask = 0;             // bit i set: joystick i is opened on a worker thread
+    bool m_initialized = false;                  // Backends initialized (by the first update() or waitForInput())
+    bool m_startupScanned = false;               // The joysticks present at startup are known
+    std::uint32_t m_startupMask = 0;             // bit i set: joystick i present at startup is not live yet
+    std::chrono::steady_clock::time_point m_startTime; // Initialization of the backends
+    js::StartupTimes m_startup;                  // Time until the joysticks present at startup went live
 };
 
 } // namespace priv
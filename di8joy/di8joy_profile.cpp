@@ -0,0 +1,296 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+// implements the capability profile cache of the di8joy library
+
+#include "di8joy_profile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+namespace
+{
+
+// anonymous namespace for things to be kept private to this translation unit
+
+// header of the profiles in the file layout of this build
+hd::priv::jsProfileHeader makeHeader(std::uint32_t count, std::uint32_t checksum)
+{
+    return hd::priv::jsProfileHeader{{'J', '2', 'K', 'P'},
+                                     hd::priv::jsProfileHeader::current,
+                                     hd::js::max_nAxis,
+                                     hd::js::max_nPOV,
+                                     hd::js::max_nButton,
+                                     0,
+                                     count,
+                                     checksum};
+}
+
+} // anonymous namespace
+
+namespace hd
+{
+
+std::ostream &err();
+
+namespace priv
+{
+
+////////////////////////////////////////////////////////////
+bool jsProfileCache::find(unsigned int vendorId, unsigned int productId, std::uint32_t nameHash, jsProfile &profile) const
+{
+    if ((vendorId == 0) || (productId == 0))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto found = m_profiles.find(key(vendorId, productId));
+
+    // another device with the same ids (or another firmware) is enumerated again
+    if ((found == m_profiles.end()) || (found->second.nameHash != nameHash))
+        return false;
+
+    profile = found->second;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+void jsProfileCache::store(const jsProfile &profile)
+{
+    if ((profile.vendorId == 0) || (profile.productId == 0))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_profiles[key(profile.vendorId, profile.productId)] = profile;
+
+    // a rejection is kept for this session only, another one may succeed (e.g. after a driver update)
+    if (!m_path.empty() && !(profile.flags & jsProfile::Rejected))
+        save();
+}
+
+////////////////////////////////////////////////////////////
+bool jsProfileCache::setFile(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_path = path;
+
+    if (m_path.empty())
+        return true;
+
+    std::FILE *file = std::fopen(m_path.c_str(), "rb");
+
+    // no file yet: it is created with the first profile stored
+    if (!file)
+        return true;
+
+    std::vector<unsigned char> contents;
+    unsigned char buffer[4096];
+    std::size_t size;
+
+    while ((size = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        contents.insert(contents.end(), buffer, buffer + size);
+
+    std::fclose(file);
+
+    if (!deserialize(contents.data(), contents.size()))
+    {
+        err() << "Ignoring invalid joystick profile file " << m_path << std::endl;
+
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+std::vector<unsigned char> jsProfileCache::serialize() const
+{
+    std::vector<unsigned char> data(sizeof(jsProfileHeader));
+
+    std::uint32_t count = 0;
+    for (const auto &entry : m_profiles)
+    {
+        if (entry.second.flags & jsProfile::Rejected)
+            continue;
+
+        const auto *profile = reinterpret_cast<const unsigned char *>(&entry.second);
+        data.insert(data.end(), profile, profile + sizeof(jsProfile));
+        ++count;
+    }
+
+    const jsProfileHeader header = makeHeader(count,
+                                              hash(data.data() + sizeof(jsProfileHeader), data.size() - sizeof(jsProfileHeader)));
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    return data;
+}
+
+////////////////////////////////////////////////////////////
+bool jsProfileCache::deserialize(const unsigned char *data, std::size_t size)
+{
+    if (size < sizeof(jsProfileHeader))
+        return false;
+
+    jsProfileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    // written by a build with the same layout of the profiles
+    const jsProfileHeader expected = makeHeader(header.count, header.checksum);
+    if ((std::memcmp(&header, &expected, sizeof(header)) != 0) ||
+        (size - sizeof(jsProfileHeader) != std::size_t{header.count} * sizeof(jsProfile)))
+        return false;
+
+    const unsigned char *profiles = data + sizeof(jsProfileHeader);
+    if (hash(profiles, size - sizeof(jsProfileHeader)) != header.checksum)
+        return false;
+
+    std::unordered_map<std::uint32_t, jsProfile> loaded;
+
+    for (std::uint32_t i = 0; i < header.count; ++i, profiles += sizeof(jsProfile))
+    {
+        jsProfile profile;
+        std::memcpy(&profile, profiles, sizeof(jsProfile));
+
+        // a profile with objects the backend does not have would index its tables out of range
+        if (!isValid(profile))
+            return false;
+
+        // rejections of files written before they were kept for the session only
+        if (profile.flags & jsProfile::Rejected)
+            continue;
+
+        loaded[key(profile.vendorId, profile.productId)] = profile;
+    }
+
+    m_profiles = std::move(loaded);
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+bool jsProfileCache::isValid(const jsProfile &profile) const
+{
+    if ((profile.vendorId == 0) || (profile.productId == 0))
+        return false;
+
+    auto inRange = [](const auto &objects, std::int32_t limit) {
+        return std::all_of(std::begin(objects), std::end(objects),
+                           [limit](std::int32_t object) { return (object >= -1) && (object < limit); });
+    };
+
+    return inRange(profile.axes, m_limits.axis) && inRange(profile.povs, m_limits.pov) &&
+           inRange(profile.buttons, m_limits.button);
+}
+
+////////////////////////////////////////////////////////////
+std::uint32_t jsProfileCache::hash(const void *data, std::size_t size, std::uint32_t seed)
+{
+    const auto *bytes = static_cast<const unsigned char *>(data);
+
+    std::uint32_t result = seed;
+    for (std::size_t i = 0; i < size; ++i)
+        result = (result ^ bytes[i]) * 16777619u;
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////
+std::uint32_t jsProfileCache::hash(const std::wstring &name)
+{
+    // hash the characters as 16 bit values, so the result is the same for any size of wchar_t
+    std::uint32_t result = 2166136261u;
+    for (wchar_t c : name)
+    {
+        const unsigned char bytes[2] = {static_cast<unsigned char>(c & 0xFF), static_cast<unsigned char>((c >> 8) & 0xFF)};
+        result = hash(bytes, sizeof(bytes), result);
+    }
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////
+bool jsProfileCache::save() const
+{
+    const std::vector<unsigned char> data = serialize();
+
+    // write a temporary file and replace the old one with it, so the file is never left half written
+    const std::string temporary = m_path + ".tmp";
+    std::FILE *file = std::fopen(temporary.c_str(), "wb");
+
+    if (!file)
+    {
+        err() << "Failed to create joystick profile file " << temporary << ": " << std::strerror(errno) << std::endl;
+
+        return false;
+    }
+
+    const bool written = (std::fwrite(data.data(), 1, data.size(), file) == data.size());
+
+    if ((std::fclose(file) != 0) || !written)
+    {
+        err() << "Failed to write joystick profile file " << temporary << std::endl;
+        std::remove(temporary.c_str());
+
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, m_path, error);
+
+    if (error)
+    {
+        err() << "Failed to replace joystick profile file " << m_path << ": " << error.message() << std::endl;
+        std::remove(temporary.c_str());
+
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace priv
+
+} // namespace hd
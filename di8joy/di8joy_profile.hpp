@@ -0,0 +1,172 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+#ifndef DI8JOY_PROFILE_HPP
+#define DI8JOY_PROFILE_HPP
+
+// author: Daniel Hug, 2022
+
+// capability profiles of devices, cached per vendor and product id
+//
+// Opening a device of the platform enumerates its controls, queries the axis ranges
+// and probes its input mode: several round trips to the driver per open, and again
+// after each reconnect. The result of this discovery is kept as a jsProfile, so a
+// device that was seen before (same vendor id, product id and name) is opened from
+// its profile without enumerating it again. Devices found unusable are kept as well
+// (jsProfile::Rejected) and are refused without any further probing, for the session
+// only: a rejection may be temporary or fixed by a driver update.
+//
+// The profiles are kept in memory and optionally in a file, which is rewritten
+// whenever a new profile is stored (rejections are not written). File layout: a jsProfileHeader followed by
+// jsProfileHeader::count jsProfile records, in the byte order of the writing
+// machine. A file is only used if header, size and checksum are valid, it was
+// written by a build of the same capacities (js::max_n*) and all backend objects of
+// its profiles are within the limits of the backend, it is replaced otherwise.
+//
+// The devices may be opened concurrently: find() and store() are thread safe.
+
+#include "di8joy.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hd
+{
+
+namespace priv
+{
+
+struct jsProfile
+{
+    enum Flags : std::uint8_t
+    {
+        Rejected = 1, // the device can not be used (e.g. its axes can not be set to absolute mode)
+        Buffered = 2  // the device supports buffered input (DirectInput)
+    };
+
+    std::uint16_t vendorId{0};                // Manufacturer identifier
+    std::uint16_t productId{0};               // Product identifier
+    std::uint32_t nameHash{0};                // jsProfileCache::hash() of the device name
+    std::uint8_t flags{0};                    // jsProfile::Flags
+    std::uint8_t reserved[3]{};               // 0
+    std::int32_t axes[js::max_nAxis]{};       // Backend object of each axis (offset or event code), -1 if not available
+    std::int32_t povs[js::max_nPOV]{};        // Backend object of each pov hat, -1 if not available
+    std::int32_t buttons[js::max_nButton]{};  // Backend object of each button, -1 if not available
+    std::int32_t axisMin[js::max_nAxis]{};    // Device minimum of each axis (if the backend needs it)
+    std::int32_t axisRange[js::max_nAxis]{};  // Device range of each axis (if the backend needs it), 0 if unknown
+};
+
+struct jsProfileHeader
+{
+    char magic[4];          // "J2KP"
+    std::uint32_t version;  // jsProfileHeader::current
+    std::uint16_t nAxis;    // js::max_nAxis of the writing build
+    std::uint16_t nPOV;     // js::max_nPOV of the writing build
+    std::uint16_t nButton;  // js::max_nButton of the writing build
+    std::uint16_t reserved; // 0
+    std::uint32_t count;    // Number of profiles following the header
+    std::uint32_t checksum; // jsProfileCache::hash() of the profiles
+    enum
+    {
+        current = 1
+    };
+};
+
+struct jsProfileLimits // backend objects of a profile are -1 or 0 ... limit - 1
+{
+    std::int32_t axis;   // e.g. ABS_CNT
+    std::int32_t pov;    // e.g. number of evdev hats
+    std::int32_t button; // e.g. KEY_CNT
+};
+
+static_assert(sizeof(jsProfileHeader) == 24, "unexpected padding of jsProfileHeader");
+static_assert(sizeof(jsProfile) == 12 + 4 * (3 * js::max_nAxis + js::max_nPOV + js::max_nButton),
+              "unexpected padding of jsProfile");
+
+class jsProfileCache
+{
+  public:
+    explicit jsProfileCache(const jsProfileLimits &limits) : m_limits(limits)
+    {
+    }
+
+    // copy the profile of the device into profile, false if unknown (also if vendorId or productId is 0:
+    // such devices are not cached)
+    bool find(unsigned int vendorId, unsigned int productId, std::uint32_t nameHash, jsProfile &profile) const;
+
+    void store(const jsProfile &profile); // add or replace the profile of its device, rewrites the file if any
+                                          // (unless the profile is rejected)
+
+    // Use the file at path: its profiles are loaded if it is valid, new profiles are stored in it.
+    // Returns false if the file exists but is not valid (it is replaced with the next store()).
+    // An empty path keeps the profiles in memory only.
+    bool setFile(const std::string &path);
+
+    // file contents of the profiles except the rejected ones and back
+    // (not guarded by the mutex: setFile() and store() hold it)
+    std::vector<unsigned char> serialize() const;
+
+    bool deserialize(const unsigned char *data, std::size_t size); // replace the profiles by valid file contents
+
+    bool isValid(const jsProfile &profile) const; // ids set and all backend objects within the limits
+
+    static std::uint32_t hash(const void *data, std::size_t size, std::uint32_t seed = 2166136261u); // FNV-1a
+
+    static std::uint32_t hash(const std::wstring &name);
+
+  private:
+    static std::uint32_t key(unsigned int vendorId, unsigned int productId)
+    {
+        return ((vendorId & 0xFFFFu) << 16) | (productId & 0xFFFFu);
+    }
+
+    bool save() const;
+
+    jsProfileLimits m_limits;                                 // Limits of the backend objects
+    std::unordered_map<std::uint32_t, jsProfile> m_profiles; // Profiles by vendorId << 16 | productId
+    std::string m_path;                                       // File of the profiles, empty if none
+    mutable std::mutex m_mutex;                               // Guards the profiles and the file
+};
+
+} // namespace priv
+
+} // namespace hd
+
+#endif // DI8JOY_PROFILE_HPP
@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+#ifndef DI8JOY_QUEUE_HPP
+#define DI8JOY_QUEUE_HPP
+
+// author: Daniel Hug, 2022
+
+// event queue of the di8joy library
+//
+// A ring of fixed capacity with a single producer (the thread calling update())
+// and a single consumer (the thread calling pollEvent()/waitEvent()). It never
+// allocates and never blocks: if the consumer falls behind, new events are
+// dropped and counted, the consumer can resynchronize from the state snapshots.
+
+#include "di8joy.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace hd
+{
+
+namespace priv
+{
+
+class jsEventQueue
+{
+  public:
+    enum
+    {
+        capacity = 1024 // max. number of queued events (a power of 2)
+    };
+
+    bool push(const js::Event &event) // producer only
+    {
+        const std::uint32_t write = m_write.load(std::memory_order_relaxed);
+
+        if (write - m_read.load(std::memory_order_acquire) == capacity)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_events[write % capacity] = event;
+        m_write.store(write + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool pop(js::Event &event) // consumer only
+    {
+        const std::uint32_t read = m_read.load(std::memory_order_relaxed);
+
+        if (read == m_write.load(std::memory_order_acquire))
+            return false;
+
+        event = m_events[read % capacity];
+        m_read.store(read + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    unsigned int getDroppedCount() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of 2");
+
+    alignas(64) std::atomic<std::uint32_t> m_write{0}; // Number of events pushed (written by the producer)
+    alignas(64) std::atomic<std::uint32_t> m_read{0};  // Number of events popped (written by the consumer)
+    std::atomic<unsigned int> m_dropped{0};            // Number of events dropped because the ring was full
+    js::Event m_events[capacity];                      // Ring storage, index: count % capacity
+};
+
+} // namespace priv
+
+} // namespace hd
+
+#endif // DI8JOY_QUEUE_HPP
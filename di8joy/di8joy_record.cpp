@@ -0,0 +1,227 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+// implements the event recorder of the di8joy library
+
+#include "di8joy_record.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+namespace hd
+{
+
+std::ostream &err();
+
+namespace priv
+{
+
+////////////////////////////////////////////////////////////
+jsRecorder::~jsRecorder()
+{
+    stop();
+}
+
+////////////////////////////////////////////////////////////
+bool jsRecorder::start(const std::string &path)
+{
+    stop();
+
+    m_file = std::fopen(path.c_str(), "wb");
+
+    if (!m_file)
+    {
+        err() << "Failed to create recording " << path << ": " << std::strerror(errno) << std::endl;
+
+        return false;
+    }
+
+    jsRecordHeader header{{'J', '2', 'K', 'R'}, jsRecordHeader::current};
+    std::fwrite(&header, sizeof(header), 1, m_file);
+
+    m_start = js::Event::Clock::now();
+    m_pending.clear();
+    m_lastTime = 0;
+    std::fill(std::begin(m_connected), std::end(m_connected), 0);
+    m_stop = false;
+    m_writer = std::thread(&jsRecorder::write, this);
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+void jsRecorder::stop()
+{
+    if (!m_file)
+        return;
+
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_signal.notify_one();
+    m_writer.join();
+
+    std::fclose(m_file);
+    m_file = nullptr;
+}
+
+////////////////////////////////////////////////////////////
+void jsRecorder::recordConnect(unsigned int jsIdx, const jsCaps &caps, const js::Id &id)
+{
+    std::uint32_t axes = 0;
+    for (unsigned int i = 0; i < js::max_nAxis; ++i)
+        axes |= static_cast<std::uint32_t>(caps.axes[i]) << i;
+
+    const std::uint64_t time = toTime(js::Event::Clock::now());
+    const auto joystick = static_cast<std::uint8_t>(jsIdx);
+
+    if (jsIdx < js::max_nJoystick)
+        m_connected[jsIdx] = time;
+
+    m_pending.push_back(jsRecordEntry{time, joystick, jsRecordEntry::Connected, 0, 0, caps.nButton | (caps.nPOV << 8) | (axes << 16)});
+    m_pending.push_back(jsRecordEntry{time, joystick, jsRecordEntry::Identified, 0, 0, (id.vendorId << 16) | (id.productId & 0xFFFF)});
+}
+
+////////////////////////////////////////////////////////////
+void jsRecorder::recordDisconnect(unsigned int jsIdx)
+{
+    m_pending.push_back(jsRecordEntry{toTime(js::Event::Clock::now()), static_cast<std::uint8_t>(jsIdx), jsRecordEntry::Disconnected, 0, 0, 0});
+}
+
+////////////////////////////////////////////////////////////
+void jsRecorder::record(const std::vector<js::Event> &events, unsigned int nButton)
+{
+    for (const js::Event &event : events)
+    {
+        // e.g. the releases of the virtual pov buttons when a joystick is disconnected
+        if (((event.type == js::Event::ButtonPressed) || (event.type == js::Event::ButtonReleased)) && (event.index >= nButton))
+            continue;
+
+        // buffered input read after an asynchronous open may date back to before the connect record:
+        // the replay only knows the joystick from that record on
+        const std::uint64_t connected = (event.joystick < js::max_nJoystick) ? m_connected[event.joystick] : 0;
+        jsRecordEntry entry{std::max(toTime(event.time), connected), event.joystick, event.type, event.index, 0, 0};
+
+        if (event.type == js::Event::AxisMoved)
+        {
+            const float percent = js::axisToPercent(event.axisPosition);
+            std::memcpy(&entry.value, &percent, sizeof(entry.value));
+        }
+        else if (event.type == js::Event::PovMoved)
+            entry.value = static_cast<std::uint32_t>(event.position);
+
+        m_pending.push_back(entry);
+    }
+}
+
+////////////////////////////////////////////////////////////
+void jsRecorder::flush()
+{
+    if (m_pending.empty())
+        return;
+
+    // The joysticks are recorded one after the other, the replay expects the records in the order of their time:
+    // sort them, keeping the order of records at the same time. Device timestamps may lag behind the records
+    // handed over by a previous update(), those are moved up to its last time.
+    auto earlier = [](const jsRecordEntry &a, const jsRecordEntry &b) { return a.time < b.time; };
+    if (!std::is_sorted(m_pending.begin(), m_pending.end(), earlier))
+        std::stable_sort(m_pending.begin(), m_pending.end(), earlier);
+
+    for (jsRecordEntry &entry : m_pending)
+        entry.time = std::max(entry.time, m_lastTime);
+    m_lastTime = m_pending.back().time;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_queued.empty())
+            std::swap(m_queued, m_pending);
+        else
+            m_queued.insert(m_queued.end(), m_pending.begin(), m_pending.end());
+    }
+    m_signal.notify_one();
+
+    m_pending.clear();
+}
+
+////////////////////////////////////////////////////////////
+void jsRecorder::write()
+{
+    std::vector<jsRecordEntry> records;
+
+    for (;;)
+    {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_signal.wait(lock, [this] { return m_stop || !m_queued.empty(); });
+
+            // swap the vectors: the update thread continues with an empty one of the same capacity
+            records.clear();
+            std::swap(records, m_queued);
+            stop = m_stop;
+        }
+
+        if (!records.empty() && (std::fwrite(records.data(), sizeof(jsRecordEntry), records.size(), m_file) != records.size()))
+            err() << "Failed to write recording: " << std::strerror(errno) << std::endl;
+
+        if (stop)
+            break;
+    }
+
+    std::fflush(m_file);
+}
+
+////////////////////////////////////////////////////////////
+std::uint64_t jsRecorder::toTime(js::Event::Clock::time_point time) const
+{
+    // DirectInput timestamps may date back to before the start of the recording
+    if (time < m_start)
+        return 0;
+
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(time - m_start).count());
+}
+
+} // namespace priv
+
+} // namespace hd
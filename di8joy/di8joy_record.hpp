@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+#ifndef DI8JOY_RECORD_HPP
+#define DI8JOY_RECORD_HPP
+
+// author: Daniel Hug, 2022
+
+// recording of joystick events into a compact binary file (replayed by di8joy_impl_replay.cpp)
+//
+// File layout: a jsRecordHeader followed by jsRecordEntry records up to the end of
+// the file, in the byte order of the recording machine, ordered by time. Every event
+// delivered by update() becomes one record, except those of the virtual pov buttons
+// (a replay derives them from the povs again). Connects and disconnects of joysticks
+// are recorded as well, so a replay can recreate the joysticks with their capabilities.
+//
+// update() only appends the records to a vector, a background thread writes them.
+
+#include "di8joy.hpp"
+#include "di8joy_state.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hd
+{
+
+namespace priv
+{
+
+struct jsRecordHeader
+{
+    char magic[4];         // "J2KR"
+    std::uint32_t version; // jsRecordHeader::current
+    enum
+    {
+        current = 1
+    };
+};
+
+struct jsRecordEntry
+{
+    enum Type : std::uint8_t // js::Event::Type for events, or one of these
+    {
+        Connected = 16, // value: nButton | nPOV << 8 | axis mask << 16
+        Identified,     // value: vendorId << 16 | productId
+        Disconnected    // value: 0
+    };
+
+    std::uint64_t time;     // Microseconds since the start of the recording
+    std::uint8_t joystick;  // Joystick number (jsIdx)
+    std::uint8_t type;      // js::Event::Type or jsRecordEntry::Type
+    std::uint8_t index;     // Button, axis or pov hat number
+    std::uint8_t reserved;  // 0
+    std::uint32_t value;    // ButtonPressed/Released: 0, AxisMoved: float bits (percent), PovMoved: position
+};
+
+static_assert(sizeof(jsRecordHeader) == 8, "unexpected padding of jsRecordHeader");
+static_assert(sizeof(jsRecordEntry) == 16, "unexpected padding of jsRecordEntry");
+
+class jsRecorder
+{
+  public:
+    ~jsRecorder();
+
+    bool start(const std::string &path); // create path and start the writer thread
+
+    void stop(); // write the remaining records and close the file
+
+    bool isRecording() const { return m_file != nullptr; }
+
+    void recordConnect(unsigned int jsIdx, const jsCaps &caps, const js::Id &id);
+
+    void recordDisconnect(unsigned int jsIdx);
+
+    // events of one joystick (joystick set), buttons from nButton on are virtual and not recorded;
+    // events the device timed before the joystick was recorded as connected are recorded at that time
+    void record(const std::vector<js::Event> &events, unsigned int nButton);
+
+    // hand the records of the current update() to the writer thread, in the order of their time
+    void flush();
+
+  private:
+    void write(); // writer thread
+
+    std::uint64_t toTime(js::Event::Clock::time_point time) const;
+
+    std::FILE *m_file{nullptr};                     // Recording, written by the writer thread only
+    js::Event::Clock::time_point m_start;           // Time 0 of the recording
+    std::vector<jsRecordEntry> m_pending;           // Records of the current update(), not yet handed over
+    std::uint64_t m_lastTime{0};                    // Time of the last record handed over
+    std::uint64_t m_connected[js::max_nJoystick]{}; // Time of the last connect record of each joystick
+    std::vector<jsRecordEntry> m_queued;            // Records handed over to the writer thread (guarded by m_mutex)
+    bool m_stop{false};                             // Tells the writer thread to finish (guarded by m_mutex)
+    std::mutex m_mutex;                             // Guards m_queued and m_stop
+    std::condition_variable m_signal;               // Wakes up the writer thread
+    std::thread m_writer;                           // Writer thread
+};
+
+} // namespace priv
+
+} // namespace hd
+
+#endif // DI8JOY_RECORD_HPP
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////
+//
+// SFML - Simple and Fast Multimedia Library
+// Copyright (C) 2007-2022 Laurent Gomila (laurent@sfml-dev.org)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// The SFML routines related to joysticks on WIN32 from
+// SFML V2.5.1 have been used as a basis for this library
+//
+////////////////////////////////////////////////////////////
+//
+// author of modifications: Daniel Hug, 2022
+//
+// changes vs. orginial code documented here:
+// "Changes_vs_SFML_2_5_1.txt"
+//
+////////////////////////////////////////////////////////////
+
+#ifndef DI8JOY_STATE_HPP
+#define DI8JOY_STATE_HPP
+
+// author: Daniel Hug, 2022
+
+// platform independent capabilities and state of a joystick as used by all backends
+
+#include "di8joy.hpp"
+
+#include <cstdint>
+
+namespace hd
+{
+
+namespace priv
+{
+
+struct jsCaps
+{
+    unsigned int nButton{0};    // actual number of buttons supported by the joystick (max. 128)
+    unsigned int nPOV{0};       // actual number of pov hats (max. 4)
+    bool axes[js::max_nAxis]{}; // support for each axis (max. 8)
+};
+
+using jsState = js::State; // the state is part of the public API (js::getState())
+
+// Axis position of a signed 16 bit device value (the range DirectInput is set up for)
+inline js::axis_t axisFromRaw16(std::int16_t value)
+{
+#if defined(DI8JOY_AXIS_INT16)
+    return (value < -js::axisFull) ? static_cast<js::axis_t>(-js::axisFull) : value;
+#else
+    return (static_cast<float>(value) + 0.5f) * 100.f / 32767.5f;
+#endif
+}
+
+// Axis position of a device value ranging from minimum to minimum + range (range > 0)
+inline js::axis_t axisFromRange(std::int32_t value, std::int32_t minimum, std::int32_t range)
+{
+#if defined(DI8JOY_AXIS_INT16)
+    return static_cast<js::axis_t>(static_cast<std::int64_t>(value - minimum) * (2 * js::axisFull) / range - js::axisFull);
+#else
+    return static_cast<float>(value - minimum) * (200.f / static_cast<float>(range)) - 100.f;
+#endif
+}
+
+} // namespace priv
+
+} // namespace hd
+
+#endif // DI8JOY_STATE_HPP
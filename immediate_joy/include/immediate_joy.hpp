@@ -11,6 +11,7 @@
 // user inteface of immediate_joy library
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <cstdint>
 #include <string>
 
 namespace hd
@@ -56,13 +57,13 @@ class js
 
     struct dev_state
     {
-        bool connected{false};       // Is the joystick currently connected?
-        float axes[MAX_NAXIS]{};     // Current position of each axis, in range [-100.f, 100.f]
-        int povs[MAX_NPOV]{};        // Current position of each pov hat
-                                     // (-1 for center pos
-                                     // otherwise in deg starting from top with 0 in clockwise direction):
-                                     // center: -1, up: 0, U/R: 45, R: 90, D/R: 135, D: 180, D/L: 225, L: 270, U/L: 315
-        bool buttons[MAX_NBUTTON]{}; // Status of each button (true = pressed)
+        bool connected{false};                     // Is the joystick currently connected?
+        float axes[MAX_NAXIS]{};                   // Current position of each axis, in range [-100.f, 100.f]
+        int povs[MAX_NPOV]{};                      // Current position of each pov hat
+                                                   // (-1 for center pos
+                                                   // otherwise in deg starting from top with 0 in clockwise direction):
+                                                   // center: -1, up: 0, U/R: 45, R: 90, D/R: 135, D: 180, D/L: 225, L: 270, U/L: 315
+        std::uint64_t buttons[MAX_NBUTTON / 64]{}; // Status of each button (bit set = pressed)
     };
 };
 
@@ -6,7 +6,6 @@
 #include <iostream>
 #include <sstream>
 #include <string>
-#include <thread>
 
 #include <windows.h>
 
@@ -114,22 +113,43 @@ int main()
     HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
     GetConsoleScreenBufferInfo(hConsole, &coninfo); // get current console position
 
+    // displayed button states ('0'/'1') of each joystick, and whether it was connected at the last look
+    std::string buttons[hd::js::max_nJoystick];
+    bool connected[hd::js::max_nJoystick]{};
+
     while (true)
     {
+        // sleep until a joystick reports input (or is plugged in or out),
+        // the timeout keeps the ESC check below responsive
+        hd::js::waitForInput(100ms);
+        hd::js::update();
 
         for (unsigned int i = 0; i < hd::js::max_nJoystick; ++i)
         {
-            if (hd::js::isConnected(i))
+            const bool isConnected = hd::js::isConnected(i);
+            const bool reconnected = isConnected && (!connected[i] || (buttons[i].size() != hd::js::getButtonCount(i)));
+            connected[i] = isConnected;
+
+            if (!isConnected)
+                continue;
+
+            std::string &outstr = buttons[i];
+            if (reconnected)
             {
-                hd::js::update();
-                std::cout << "Joystick " << i << ": ";
-                std::string outstr{};
+                // a joystick (maybe another one) connected to the slot: build its buttons from the state
+                outstr.clear();
                 for (unsigned int j = 0; j < hd::js::getButtonCount(i); ++j)
-                {
-                    outstr += (hd::js::isButtonPressed(i, j)) ? "1" : "0";
-                }
-                std::cout << outstr << std::endl;
+                    outstr += (hd::js::isButtonPressed(i, j)) ? '1' : '0';
+            }
+            else
+            {
+                // only the buttons toggled by the last update need to be changed
+                hd::js::ButtonEdges edges = hd::js::getButtonEdges(i);
+                edges.pressed.forEach([&outstr](unsigned int j) { if (j < outstr.size()) outstr[j] = '1'; });
+                edges.released.forEach([&outstr](unsigned int j) { if (j < outstr.size()) outstr[j] = '0'; });
             }
+
+            std::cout << "Joystick " << i << ": " << outstr << std::endl;
         }
 
         // move cusor back to initial position
@@ -141,8 +161,6 @@ int main()
         // quit on ESC keypress
         if (GetAsyncKeyState(VK_ESCAPE))
             break;
-
-        std::this_thread::sleep_for(100ms);
     }
 
     return 0;
@@ -8,12 +8,107 @@
 #include <windows.h>
 
 #include "di8joy/di8joy.hpp"
+#include "joy2key/joy2key_binding.hpp"
+#include "joy2key/joy2key_image.hpp"
+#include "joy2key/joy2key_profiles.hpp"
+#include "joy2key/joy2key_timer.hpp"
 #include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <stop_token>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
+namespace
+{
+
+using namespace std::chrono_literals;
+
+constexpr std::chrono::milliseconds maxWait = 100ms; // max. wait for input before checking for the end
+
+const std::string configFile = "joy2key.cfg"; // text configuration, see joy2key/joy2key_config.hpp
+const std::string imageFile = "joy2key.j2k";  // compiled configuration, rebuilt when configFile is newer
+
+hd::j2k::ProfileSet profiles;        // compiled bindings of all profiles and the active one
+hd::j2k::PressTimer pressTimer;      // long press deadlines of the held buttons in timed mode
+
+// modifier bits of hd::j2k::KeyStroke and their virtual key codes
+constexpr std::pair<std::uint8_t, WORD> modifierKeys[] = {
+    {hd::j2k::LShift, VK_LSHIFT},  {hd::j2k::RShift, VK_RSHIFT}, {hd::j2k::LCtrl, VK_LCONTROL},
+    {hd::j2k::RCtrl, VK_RCONTROL}, {hd::j2k::LAlt, VK_LMENU},    {hd::j2k::RAlt, VK_RMENU},
+    {hd::j2k::LWin, VK_LWIN},      {hd::j2k::RWin, VK_RWIN}};
+
+void addKey(std::vector<INPUT> &inputs, WORD key, bool up)
+{
+    INPUT &input = inputs.emplace_back();
+    input.type = INPUT_KEYBOARD;
+    input.ki.wVk = key;
+    input.ki.dwFlags = up ? KEYEVENTF_KEYUP : 0;
+}
+
+// send the key strokes of an action to the window having the keyboard focus,
+// then switch to the profile of the action (used from the next update() on)
+void performAction(const hd::j2k::BindingTable &bindings, const hd::j2k::Action &action)
+{
+    static std::vector<INPUT> inputs;
+
+    inputs.clear();
+    const hd::j2k::KeyStroke *keys = bindings.keys(action);
+    for (unsigned int i = 0; i < action.nKey; ++i)
+    {
+        for (const auto &[bit, key] : modifierKeys)
+            if (keys[i].modifiers & bit)
+                addKey(inputs, key, false);
+        addKey(inputs, keys[i].key, false);
+        addKey(inputs, keys[i].key, true);
+        for (const auto &[bit, key] : modifierKeys)
+            if (keys[i].modifiers & bit)
+                addKey(inputs, key, true);
+    }
+    if (!inputs.empty())
+        SendInput(static_cast<UINT>(inputs.size()), inputs.data(), sizeof(INPUT));
+
+    if (action.profile >= 0)
+        profiles.select(static_cast<unsigned int>(action.profile));
+}
+
+// wait for input or the next long press deadline, then dispatch the button edges and the
+// long press actions due (runs on its own thread, which is the thread calling update())
+void inputLoop(std::stop_token stop)
+{
+    using Clock = hd::j2k::PressTimer::Clock;
+
+    while (!stop.stop_requested())
+    {
+        std::chrono::milliseconds timeout = maxWait;
+        if (!pressTimer.empty())
+            timeout = std::clamp(std::chrono::ceil<std::chrono::milliseconds>(pressTimer.nextDeadline() - Clock::now()),
+                                 0ms, maxWait);
+        hd::js::waitForInput(timeout);
+
+        hd::js::update();
+        const Clock::time_point now = Clock::now();
+        const hd::j2k::BindingTable &bindings = profiles.table();
+        const auto perform = [&bindings](const hd::j2k::Action &action) { performAction(bindings, action); };
+        for (unsigned int jsIdx = 0; jsIdx < hd::js::max_nJoystick; ++jsIdx)
+        {
+            // the events tell when the device saw each press and release, also of taps within one update()
+            if (hd::js::isConnected(jsIdx))
+                bindings.dispatch(jsIdx, hd::js::getEvents(jsIdx), pressTimer, perform);
+            else if (!pressTimer.empty())
+                pressTimer.cancel(jsIdx);
+        }
+        bindings.expire(now, pressTimer, perform);
+        profiles.quiescent();
+    }
+}
+
+} // anonymous namespace
+
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine, int nCmdShow)
 {
     // Register the window class.
@@ -51,6 +146,12 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
 
     ShowWindow(hwnd, nCmdShow);
 
+    // map the compiled profiles, without a valid configuration no buttons are bound
+    if (auto image = hd::j2k::ProfileImage::open(configFile, imageFile))
+        profiles.load(std::move(image));
+
+    std::jthread input(inputLoop); // stopped and joined when leaving wWinMain
+
     // Run the message loop.
 
     MSG msg = {};
@@ -85,4 +186,4 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         return 0;
     }
     return DefWindowProc(hwnd, uMsg, wParam, lParam);
-}
\ No newline at end of file
+}
\ No newline at end of file
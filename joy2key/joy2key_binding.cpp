@@ -0,0 +1,143 @@
+// author: Daniel Hug, 2022
+
+#include "joy2key_binding.hpp"
+
+#include <chrono>
+#include <limits>
+#include <ostream>
+
+namespace hd
+{
+
+std::ostream &err();
+
+namespace j2k
+{
+
+////////////////////////////////////////////////////////////
+BindingTable::BindingTable()
+    : m_slots(nSlot, 0), m_longPress(nButtonSlot, 0), m_actions(1), m_names(1, 0), m_strings(1, '\0')
+{
+    own();
+}
+
+////////////////////////////////////////////////////////////
+BindingTable::BindingTable(const Arrays &arrays) : m_arrays(arrays)
+{
+}
+
+////////////////////////////////////////////////////////////
+void BindingTable::own()
+{
+    m_arrays.slots = m_slots.data();
+    m_arrays.longPress = m_longPress.data();
+    m_arrays.actions = m_actions.data();
+    m_arrays.nAction = m_actions.size();
+    m_arrays.keys = m_keys.data();
+    m_arrays.nKey = m_keys.size();
+    m_arrays.names = m_names.data();
+    m_arrays.strings = m_strings.data();
+    m_arrays.nString = m_strings.size();
+}
+
+////////////////////////////////////////////////////////////
+bool BindingTable::compile(const Profile &profile)
+{
+    std::vector<std::uint16_t> slots(nSlot, 0);
+    std::vector<std::uint32_t> longPress(nButtonSlot, 0);
+    std::vector<Action> actions(1);
+    std::vector<KeyStroke> keys;
+    std::vector<std::uint32_t> names(1, 0);
+    std::vector<char> strings(1, '\0');
+
+    actions.reserve(profile.bindings.size() + 1);
+    names.reserve(profile.bindings.size() + 1);
+
+    for (const Binding &binding : profile.bindings)
+    {
+        if (binding.joystick >= js::max_nJoystick || binding.button >= js::max_nButton || binding.edge >= nEdge)
+        {
+            err() << "Profile \"" << profile.name << "\", action \"" << binding.name << "\": joystick "
+                  << binding.joystick << ", button " << binding.button << " is out of range." << std::endl;
+            return false;
+        }
+        if (actions.size() > std::numeric_limits<std::uint16_t>::max() ||
+            binding.keys.size() > std::numeric_limits<std::uint16_t>::max() ||
+            binding.profile > std::numeric_limits<std::int16_t>::max() ||
+            keys.size() + binding.keys.size() > std::numeric_limits<std::uint32_t>::max() ||
+            strings.size() + binding.name.size() >= std::numeric_limits<std::uint32_t>::max())
+        {
+            err() << "Profile \"" << profile.name << "\" has too many actions or key strokes." << std::endl;
+            return false;
+        }
+
+        std::uint16_t &target = slots[slot(binding.joystick, binding.button, binding.edge)];
+        if (target != 0)
+        {
+            err() << "Profile \"" << profile.name << "\": \"" << binding.name << "\" and \"" << &strings[names[target]]
+                  << "\" are bound to the same button of joystick " << binding.joystick << '.' << std::endl;
+            return false;
+        }
+        target = static_cast<std::uint16_t>(actions.size());
+
+        Action &action = actions.emplace_back();
+        action.firstKey = static_cast<std::uint32_t>(keys.size());
+        action.nKey = static_cast<std::uint16_t>(binding.keys.size());
+        action.profile = static_cast<std::int16_t>(binding.profile < 0 ? -1 : binding.profile);
+        keys.insert(keys.end(), binding.keys.begin(), binding.keys.end());
+        names.push_back(static_cast<std::uint32_t>(strings.size()));
+        strings.insert(strings.end(), binding.name.begin(), binding.name.end());
+        strings.push_back('\0');
+    }
+
+    // buttons with short or long press actions are in timed mode
+    const auto validTime = [](std::chrono::milliseconds time) {
+        return time.count() > 0 && time.count() <= std::numeric_limits<std::uint32_t>::max();
+    };
+    for (unsigned int jsIdx = 0; jsIdx < js::max_nJoystick; ++jsIdx)
+    {
+        for (unsigned int button = 0; button < js::max_nButton; ++button)
+        {
+            const std::uint16_t *edges = &slots[slot(jsIdx, button, Press)];
+            if (edges[ShortPress] == 0 && edges[LongPress] == 0)
+                continue;
+            if (edges[Press] != 0 || edges[Release] != 0)
+            {
+                err() << "Profile \"" << profile.name << "\": button " << button << " of joystick " << jsIdx
+                      << " has actions of the immediate and the timed mode." << std::endl;
+                return false;
+            }
+            if (!validTime(profile.longPressTime))
+            {
+                err() << "Profile \"" << profile.name << "\": invalid long press time." << std::endl;
+                return false;
+            }
+            longPress[std::size_t{jsIdx} * js::max_nButton + button] =
+                static_cast<std::uint32_t>(profile.longPressTime.count());
+        }
+    }
+    for (const LongPressTime &time : profile.longPressTimes)
+    {
+        if (time.joystick >= js::max_nJoystick || time.button >= js::max_nButton || !validTime(time.time))
+        {
+            err() << "Profile \"" << profile.name << "\": long press time of joystick " << time.joystick
+                  << ", button " << time.button << " is out of range." << std::endl;
+            return false;
+        }
+        std::uint32_t &target = longPress[std::size_t{time.joystick} * js::max_nButton + time.button];
+        if (target != 0) // only buttons in timed mode
+            target = static_cast<std::uint32_t>(time.time.count());
+    }
+
+    m_slots.swap(slots);
+    m_longPress.swap(longPress);
+    m_actions.swap(actions);
+    m_keys.swap(keys);
+    m_names.swap(names);
+    m_strings.swap(strings);
+    own();
+    return true;
+}
+
+} // namespace j2k
+} // namespace hd
@@ -0,0 +1,257 @@
+// author: Daniel Hug, 2022
+
+#ifndef JOY2KEY_BINDING_HPP
+#define JOY2KEY_BINDING_HPP
+
+// bindings of joystick buttons to actions (key strokes, profile switches)
+//
+// A Profile lists the bindings the way the user configured them. BindingTable::compile()
+// turns them into flat arrays: one action index per (joystick, virtual button, edge),
+// pointing to preresolved action records whose key strokes are stored contiguously.
+// Dispatching a button edge is a single indexed load, the configuration is not searched.
+// The arrays are owned by the table, or mapped from a compiled image (see ProfileImage).
+//
+// A button with short or long press actions is in timed mode: its press arms a deadline
+// of a PressTimer, its release before the deadline performs the short press action and
+// expire() performs the long press actions of the deadlines reached. Dispatched from the
+// events of a joystick, press and release are timed by the device: a tap within one
+// update() is a short press, which the edges of that update() do not show at all.
+
+#include "di8joy/di8joy.hpp"
+#include "joy2key/joy2key_timer.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace hd
+{
+namespace j2k
+{
+
+enum Edge : unsigned char // button change an action is bound to
+{
+    Press,      // button toggled to on (immediate mode)
+    Release,    // button toggled to off (immediate mode)
+    ShortPress, // button released before its long press time (timed mode)
+    LongPress,  // button held for its long press time (timed mode)
+
+    nEdge
+};
+
+enum Modifier : std::uint8_t // modifier keys held while a key is stroked
+{
+    LShift = 1 << 0,
+    RShift = 1 << 1,
+    LCtrl = 1 << 2,
+    RCtrl = 1 << 3,
+    LAlt = 1 << 4,
+    RAlt = 1 << 5,
+    LWin = 1 << 6,
+    RWin = 1 << 7
+};
+
+struct KeyStroke // a key pressed and released while the modifiers are held, e.g. LShift + A
+{
+    std::uint8_t modifiers{0}; // Modifier bits
+    std::uint8_t reserved{0};
+    std::uint16_t key{0};      // virtual key code (Windows VK_*)
+
+    friend bool operator==(const KeyStroke &, const KeyStroke &) = default;
+};
+
+struct Binding // what an edge of a joystick button does, as configured by the user
+{
+    unsigned int joystick{0};    // jsIdx of the joystick
+    unsigned int button{0};      // virtual button (0-based), see js::getButtonCount()
+    Edge edge{Press};            // press or release
+    std::string name;            // name of the action, e.g. "gear up"
+    std::vector<KeyStroke> keys; // key strokes sent in this order
+    int profile{-1};             // profile to switch to afterwards, -1: none
+};
+
+struct LongPressTime // long press time of a button, deviating from the default of its profile
+{
+    unsigned int joystick{0};
+    unsigned int button{0};
+    std::chrono::milliseconds time{0};
+};
+
+struct Profile // a named set of bindings
+{
+    std::string name;
+    std::vector<Binding> bindings;
+    std::chrono::milliseconds longPressTime{500}; // default long press time of the buttons in timed mode
+    std::vector<LongPressTime> longPressTimes;    // long press times of individual buttons
+};
+
+struct Action // preresolved action record of a BindingTable
+{
+    std::uint32_t firstKey{0}; // index of the first key stroke, see BindingTable::keys()
+    std::uint16_t nKey{0};     // number of key strokes
+    std::int16_t profile{-1};  // profile to switch to afterwards, -1: none
+};
+
+class BindingTable // compiled bindings of a profile
+{
+  public:
+    using Clock = PressTimer::Clock;
+
+    static constexpr std::size_t nSlot = std::size_t{js::max_nJoystick} * js::max_nButton * nEdge;
+    static constexpr std::size_t nButtonSlot = std::size_t{js::max_nJoystick} * js::max_nButton;
+
+    struct Arrays // the compiled arrays of a table
+    {
+        const std::uint16_t *slots{nullptr};     // nSlot action indices of each (joystick, button, edge), 0: unbound
+        const std::uint32_t *longPress{nullptr}; // nButtonSlot long press times (ms), 0: immediate mode
+        const Action *actions{nullptr};          // nAction action records, actions[0] is a placeholder
+        std::size_t nAction{0};
+        const KeyStroke *keys{nullptr};          // nKey key strokes of all actions
+        std::size_t nKey{0};
+        const std::uint32_t *names{nullptr};     // nAction offsets of the action names in strings
+        const char *strings{nullptr};            // nul terminated names, starting with the empty one
+        std::size_t nString{0};                  // size of strings in bytes
+    };
+
+    BindingTable(); // no bindings
+
+    explicit BindingTable(const Arrays &arrays); // view of arrays kept alive by the caller (e.g. mapped)
+
+    BindingTable(const BindingTable &) = delete; // the arrays point into the owned storage
+    BindingTable &operator=(const BindingTable &) = delete;
+    BindingTable(BindingTable &&) = default;     // moving the vectors keeps their storage
+    BindingTable &operator=(BindingTable &&) = default;
+
+    // replace the table by the bindings of profile
+    // returns false (table unchanged) if a binding is out of range, an edge is bound twice,
+    // or a button has actions of both the immediate and the timed mode
+    bool compile(const Profile &profile);
+
+    // action bound to an edge of a button, nullptr if the edge is unbound
+    const Action *find(unsigned int jsIdx, unsigned int button, Edge edge) const
+    {
+        const std::uint16_t action = m_arrays.slots[slot(jsIdx, button, edge)];
+        return action != 0 ? &m_arrays.actions[action] : nullptr;
+    }
+
+    // long press time of a button, 0 if it is in immediate mode
+    std::chrono::milliseconds longPressTime(unsigned int jsIdx, unsigned int button) const
+    {
+        return std::chrono::milliseconds{m_arrays.longPress[std::size_t{jsIdx} * js::max_nButton + button]};
+    }
+
+    // call perform(const Action &) for each bound edge of joystick jsIdx, reported at time
+    // presses of buttons in timed mode arm their deadline in timer, releases cancel it
+    // presses are dispatched before releases, each in button order
+    template <typename Perform>
+    void dispatch(unsigned int jsIdx, const js::ButtonEdges &edges, Clock::time_point time, PressTimer &timer,
+                  Perform perform) const
+    {
+        const std::uint16_t *slots = &m_arrays.slots[slot(jsIdx, 0, Press)];
+        const std::uint32_t *longPress = &m_arrays.longPress[std::size_t{jsIdx} * js::max_nButton];
+        const Action *actions = m_arrays.actions;
+
+        edges.pressed.forEach([&](unsigned int button) {
+            if (longPress[button] != 0)
+                timer.arm(jsIdx, button, time + std::chrono::milliseconds{longPress[button]});
+            else if (const std::uint16_t action = slots[button * nEdge + Press])
+                perform(actions[action]);
+        });
+        edges.released.forEach([&](unsigned int button) {
+            // a cancelled deadline is a short press, after an expired one the release does nothing
+            const Edge edge = timer.cancel(jsIdx, button) ? ShortPress : Release;
+            if (const std::uint16_t action = slots[button * nEdge + edge])
+                perform(actions[action]);
+        });
+    }
+
+    // call perform(const Action &) for each button event of joystick jsIdx in the order the device reported them,
+    // timed by the event times: presses of buttons in timed mode arm their deadline at their time plus the long
+    // press time, a release before the deadline is a short press, a release after it performs the long press
+    // action unless expire() did already
+    template <typename Perform>
+    void dispatch(unsigned int jsIdx, const std::vector<js::Event> &events, PressTimer &timer, Perform perform) const
+    {
+        const std::uint16_t *slots = &m_arrays.slots[slot(jsIdx, 0, Press)];
+        const std::uint32_t *longPress = &m_arrays.longPress[std::size_t{jsIdx} * js::max_nButton];
+        const Action *actions = m_arrays.actions;
+
+        for (const js::Event &event : events)
+        {
+            const unsigned int button = event.index;
+            if (button >= js::max_nButton)
+                continue;
+
+            if (event.type == js::Event::ButtonPressed)
+            {
+                if (longPress[button] != 0)
+                    timer.arm(jsIdx, button, event.time + std::chrono::milliseconds{longPress[button]});
+                else if (const std::uint16_t action = slots[button * nEdge + Press])
+                    perform(actions[action]);
+            }
+            else if (event.type == js::Event::ButtonReleased)
+            {
+                // after an expired deadline the release does nothing
+                const Clock::time_point deadline = timer.deadline(jsIdx, button);
+                const Edge edge = timer.cancel(jsIdx, button) ? (event.time < deadline ? ShortPress : LongPress) : Release;
+                if (const std::uint16_t action = slots[button * nEdge + edge])
+                    perform(actions[action]);
+            }
+        }
+    }
+
+    // call perform(const Action &) for the long press actions of the deadlines in timer reached at time now
+    template <typename Perform>
+    void expire(Clock::time_point now, PressTimer &timer, Perform perform) const
+    {
+        timer.expire(now, [&](unsigned int jsIdx, unsigned int button) {
+            if (const std::uint16_t action = m_arrays.slots[slot(jsIdx, button, LongPress)])
+                perform(m_arrays.actions[action]);
+        });
+    }
+
+    const KeyStroke *keys(const Action &action) const // key strokes of action
+    {
+        return m_arrays.keys + action.firstKey;
+    }
+
+    const char *name(const Action &action) const // name of action (for diagnostics)
+    {
+        return m_arrays.strings + m_arrays.names[&action - m_arrays.actions];
+    }
+
+    std::size_t getActionCount() const // number of bound edges
+    {
+        return m_arrays.nAction - 1;
+    }
+
+    const Arrays &arrays() const
+    {
+        return m_arrays;
+    }
+
+  private:
+    static std::size_t slot(unsigned int jsIdx, unsigned int button, Edge edge)
+    {
+        return (std::size_t{jsIdx} * js::max_nButton + button) * nEdge + edge;
+    }
+
+    void own(); // point the arrays to the owned storage
+
+    Arrays m_arrays; // arrays used, owned or viewed
+
+    // owned storage of the arrays of a compiled table, empty for a view
+    std::vector<std::uint16_t> m_slots;
+    std::vector<std::uint32_t> m_longPress;
+    std::vector<Action> m_actions;
+    std::vector<KeyStroke> m_keys;
+    std::vector<std::uint32_t> m_names;
+    std::vector<char> m_strings;
+};
+
+} // namespace j2k
+} // namespace hd
+
+#endif // JOY2KEY_BINDING_HPP
@@ -0,0 +1,405 @@
+// author: Daniel Hug, 2022
+
+#include "joy2key_config.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <ostream>
+#include <utility>
+
+namespace
+{
+
+// anonymous namespace for things to be kept private to this translation unit
+
+using hd::j2k::KeyStroke;
+
+struct KeyName
+{
+    std::string_view name;
+    std::uint16_t key;
+    std::uint8_t modifier; // hd::j2k::Modifier if the key can be used as modifier, 0 otherwise
+};
+
+// named keys and their virtual key codes (Windows VK_*), letters, digits and F-keys are computed
+constexpr KeyName keyNames[] = {
+    {"lshift", 0xA0, hd::j2k::LShift}, {"rshift", 0xA1, hd::j2k::RShift},  {"shift", 0xA0, hd::j2k::LShift},
+    {"lctrl", 0xA2, hd::j2k::LCtrl},   {"rctrl", 0xA3, hd::j2k::RCtrl},    {"ctrl", 0xA2, hd::j2k::LCtrl},
+    {"lalt", 0xA4, hd::j2k::LAlt},     {"ralt", 0xA5, hd::j2k::RAlt},      {"alt", 0xA4, hd::j2k::LAlt},
+    {"lwin", 0x5B, hd::j2k::LWin},     {"rwin", 0x5C, hd::j2k::RWin},      {"esc", 0x1B, 0},
+    {"tab", 0x09, 0},                  {"space", 0x20, 0},                 {"enter", 0x0D, 0},
+    {"backspace", 0x08, 0},            {"insert", 0x2D, 0},                {"delete", 0x2E, 0},
+    {"home", 0x24, 0},                 {"end", 0x23, 0},                   {"pgup", 0x21, 0},
+    {"pgdn", 0x22, 0},                 {"up", 0x26, 0},                    {"down", 0x28, 0},
+    {"left", 0x25, 0},                 {"right", 0x27, 0},                 {"pause", 0x13, 0},
+    {"print", 0x2C, 0},                {"capslock", 0x14, 0},              {"numlock", 0x90, 0},
+    {"scrolllock", 0x91, 0}};
+
+std::string_view trim(std::string_view text)
+{
+    const auto space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+    while (!text.empty() && space(text.front()))
+        text.remove_prefix(1);
+    while (!text.empty() && space(text.back()))
+        text.remove_suffix(1);
+    return text;
+}
+
+std::string lower(std::string_view text)
+{
+    std::string result(text);
+    for (char &c : result)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return result;
+}
+
+bool parseNumber(std::string_view text, unsigned int &number, int base = 10)
+{
+    text = trim(text);
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number, base);
+    return !text.empty() && error == std::errc{} && end == text.data() + text.size();
+}
+
+// virtual key code of a key name, 0 if unknown; modifier is set if the key can be a modifier
+std::uint16_t findKey(std::string_view text, std::uint8_t &modifier)
+{
+    const std::string name = lower(trim(text));
+    unsigned int number = 0;
+
+    modifier = 0;
+    if (name.size() == 1 && ((name[0] >= 'a' && name[0] <= 'z') || (name[0] >= '0' && name[0] <= '9')))
+        return static_cast<std::uint16_t>(std::toupper(static_cast<unsigned char>(name[0]))); // VK_A = 'A', VK_0 = '0'
+    if (name.size() > 1 && name[0] == 'f' && parseNumber(std::string_view(name).substr(1), number) && number >= 1 &&
+        number <= 24)
+        return static_cast<std::uint16_t>(0x70 + number - 1); // VK_F1 ...
+    if (name.size() == 4 && name.starts_with("num") && name[3] >= '0' && name[3] <= '9')
+        return static_cast<std::uint16_t>(0x60 + (name[3] - '0')); // VK_NUMPAD0 ...
+    if (name.starts_with("0x") && parseNumber(std::string_view(name).substr(2), number, 16) && number > 0 &&
+        number <= 0xFF)
+        return static_cast<std::uint16_t>(number);
+
+    for (const KeyName &key : keyNames)
+    {
+        if (key.name == name)
+        {
+            modifier = key.modifier;
+            return key.key;
+        }
+    }
+    return 0;
+}
+
+// a reference to a button, resolved when all display names are known
+struct ButtonRef
+{
+    unsigned int joystick{0};
+    std::string button; // number (1-based) or display name
+};
+
+bool splitRef(std::string_view text, ButtonRef &ref)
+{
+    const std::size_t dot = text.find('.');
+    if (dot == std::string_view::npos || !parseNumber(text.substr(0, dot), ref.joystick) || ref.joystick == 0)
+        return false;
+    ref.joystick -= 1;
+    ref.button = trim(text.substr(dot + 1));
+    return !ref.button.empty();
+}
+
+} // anonymous namespace
+
+namespace hd
+{
+
+std::ostream &err();
+
+namespace j2k
+{
+
+////////////////////////////////////////////////////////////
+bool parseKeys(std::string_view text, std::vector<KeyStroke> &keys)
+{
+    std::vector<KeyStroke> result;
+
+    while (!trim(text).empty())
+    {
+        const std::size_t comma = text.find(',');
+        std::string_view stroke = text.substr(0, comma);
+        text = (comma == std::string_view::npos) ? std::string_view{} : text.substr(comma + 1);
+
+        // modifiers + key
+        KeyStroke &key = result.emplace_back();
+        for (;;)
+        {
+            const std::size_t plus = stroke.find('+');
+            std::uint8_t modifier = 0;
+            key.key = findKey(stroke.substr(0, plus), modifier);
+            if (key.key == 0)
+                return false;
+            if (plus == std::string_view::npos)
+                break;
+            if (modifier == 0)
+                return false;
+            key.modifiers |= modifier;
+            stroke.remove_prefix(plus + 1);
+        }
+    }
+
+    keys = std::move(result);
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+bool parseConfig(std::istream &in, const std::string &source, Config &config)
+{
+    Config result;
+    result.joysticks.resize(js::max_nJoystick);
+
+    struct Pending // binding or long press time to resolve at the end
+    {
+        unsigned int line;
+        std::size_t profile;
+        ButtonRef ref;
+        std::size_t binding;    // index into the bindings, or the long press times if timing
+        bool timing;
+        std::string target;     // profile to switch to, empty if none
+    };
+    std::vector<Pending> pending;
+    std::vector<bool> ownLongPress; // per profile: long press time given in the profile
+
+    std::chrono::milliseconds longPressTime = Profile{}.longPressTime;
+    enum { None, Joystick, InProfile } section = None;
+    unsigned int joystick = 0;
+    unsigned int lineNumber = 0;
+    bool ok = true;
+
+    const auto error = [&](const std::string &message) {
+        err() << source << '(' << lineNumber << "): " << message << std::endl;
+        ok = false;
+    };
+
+    std::string buffer;
+    while (std::getline(in, buffer))
+    {
+        ++lineNumber;
+        std::string_view line = buffer;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+
+        // section header
+        if (line.front() == '[')
+        {
+            if (line.back() != ']')
+            {
+                error("missing ']'");
+                continue;
+            }
+            const std::string_view header = trim(line.substr(1, line.size() - 2));
+            const std::size_t space = header.find_first_of(" \t");
+            const std::string kind = lower(header.substr(0, space));
+            const std::string_view name = space == std::string_view::npos ? std::string_view{} : trim(header.substr(space));
+            if (kind == "joystick" && parseNumber(name, joystick) && joystick >= 1 && joystick <= js::max_nJoystick)
+            {
+                section = Joystick;
+                joystick -= 1;
+            }
+            else if (kind == "profile" && !name.empty())
+            {
+                if (std::any_of(result.profiles.begin(), result.profiles.end(),
+                                [&](const Profile &profile) { return profile.name == name; }))
+                    error("profile \"" + std::string(name) + "\" is defined twice");
+                section = InProfile;
+                result.profiles.emplace_back().name = name;
+                ownLongPress.push_back(false);
+            }
+            else
+            {
+                error("unknown section [" + std::string(header) + "]");
+                section = None;
+            }
+            continue;
+        }
+
+        const std::size_t equal = line.find('=');
+        if (equal == std::string_view::npos)
+        {
+            error("missing '='");
+            continue;
+        }
+        const std::string_view key = trim(line.substr(0, equal));
+        const std::string_view value = trim(line.substr(equal + 1));
+        const std::string lowerKey = lower(key);
+
+        // long press time [joystick.button] = ms
+        if (lowerKey.starts_with("long press time") && section != Joystick)
+        {
+            const std::string_view button = trim(key.substr(15));
+            unsigned int ms = 0;
+            if (!parseNumber(value, ms) || ms == 0)
+                error("invalid long press time");
+            else if (button.empty() && section == None)
+                longPressTime = std::chrono::milliseconds{ms};
+            else if (button.empty())
+            {
+                result.profiles.back().longPressTime = std::chrono::milliseconds{ms};
+                ownLongPress.back() = true;
+            }
+            else if (ButtonRef ref; section == InProfile && splitRef(button, ref))
+            {
+                std::vector<LongPressTime> &times = result.profiles.back().longPressTimes;
+                pending.push_back({lineNumber, result.profiles.size() - 1, ref, times.size(), true, {}});
+                times.push_back({ref.joystick, 0, std::chrono::milliseconds{ms}});
+            }
+            else
+                error("invalid button \"" + std::string(button) + "\"");
+            continue;
+        }
+
+        if (section == Joystick)
+        {
+            unsigned int button = 0;
+            if (lowerKey == "name")
+                result.joysticks[joystick] = value;
+            else if (lowerKey.starts_with("button") && parseNumber(key.substr(6), button) && button >= 1 &&
+                     button <= js::max_nButton)
+                result.buttons.push_back({joystick, button - 1, std::string(value)});
+            else
+                error("unknown setting \"" + std::string(key) + "\"");
+            continue;
+        }
+
+        if (section != InProfile)
+        {
+            error("unknown setting \"" + std::string(key) + "\"");
+            continue;
+        }
+
+        // joystick.button edge = [name:] keys [-> profile]
+        const std::size_t space = key.find_last_of(" \t");
+        const std::string edgeName = lower(space == std::string_view::npos ? key : key.substr(space + 1));
+        Binding binding;
+        if (edgeName == "press")
+            binding.edge = Press;
+        else if (edgeName == "release")
+            binding.edge = Release;
+        else if (edgeName == "short")
+            binding.edge = ShortPress;
+        else if (edgeName == "long")
+            binding.edge = LongPress;
+        else
+        {
+            error("unknown edge \"" + edgeName + "\" (press, release, short or long)");
+            continue;
+        }
+
+        ButtonRef ref;
+        if (space == std::string_view::npos || !splitRef(trim(key.substr(0, space)), ref))
+        {
+            error("invalid button \"" + std::string(key) + "\"");
+            continue;
+        }
+        binding.joystick = ref.joystick;
+
+        std::string_view action = value;
+        std::string target;
+        if (const std::size_t arrow = action.find("->"); arrow != std::string_view::npos)
+        {
+            target = trim(action.substr(arrow + 2));
+            action = trim(action.substr(0, arrow));
+        }
+        if (const std::size_t colon = action.find(':'); colon != std::string_view::npos)
+        {
+            binding.name = trim(action.substr(0, colon));
+            action = action.substr(colon + 1);
+        }
+        if (binding.name.empty())
+            binding.name = std::string(key);
+        if (!parseKeys(action, binding.keys))
+        {
+            error("invalid key strokes \"" + std::string(trim(action)) + "\"");
+            continue;
+        }
+        if (binding.keys.empty() && target.empty())
+        {
+            error("action without key strokes or profile");
+            continue;
+        }
+
+        std::vector<Binding> &bindings = result.profiles.back().bindings;
+        pending.push_back({lineNumber, result.profiles.size() - 1, std::move(ref), bindings.size(), false, target});
+        bindings.push_back(std::move(binding));
+    }
+
+    // resolve the buttons and profiles referenced now that all names are known
+    for (Pending &entry : pending)
+    {
+        lineNumber = entry.line;
+        unsigned int button = 0;
+        if (parseNumber(entry.ref.button, button) && button >= 1 && button <= js::max_nButton)
+            button -= 1;
+        else
+        {
+            const auto found = std::find_if(result.buttons.begin(), result.buttons.end(), [&](const ButtonName &name) {
+                return name.joystick == entry.ref.joystick && name.name == entry.ref.button;
+            });
+            if (found == result.buttons.end())
+            {
+                error("unknown button \"" + entry.ref.button + "\" of joystick " + std::to_string(entry.ref.joystick + 1));
+                continue;
+            }
+            button = found->button;
+        }
+
+        Profile &profile = result.profiles[entry.profile];
+        if (entry.timing)
+        {
+            profile.longPressTimes[entry.binding].button = button;
+            continue;
+        }
+
+        Binding &binding = profile.bindings[entry.binding];
+        binding.button = button;
+        if (!entry.target.empty())
+        {
+            const auto found = std::find_if(result.profiles.begin(), result.profiles.end(),
+                                            [&](const Profile &target) { return target.name == entry.target; });
+            if (found == result.profiles.end())
+                error("unknown profile \"" + entry.target + "\"");
+            else
+                binding.profile = static_cast<int>(found - result.profiles.begin());
+        }
+    }
+
+    if (result.profiles.empty())
+    {
+        lineNumber = 0;
+        error("no profile defined");
+    }
+    if (!ok)
+        return false;
+
+    for (std::size_t i = 0; i < result.profiles.size(); ++i)
+        if (!ownLongPress[i])
+            result.profiles[i].longPressTime = longPressTime;
+
+    config = std::move(result);
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+bool readConfig(const std::string &path, Config &config)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        err() << "Failed to open joy2key configuration " << path << std::endl;
+        return false;
+    }
+    return parseConfig(in, path, config);
+}
+
+} // namespace j2k
+} // namespace hd
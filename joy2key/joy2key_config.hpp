@@ -0,0 +1,68 @@
+// author: Daniel Hug, 2022
+
+#ifndef JOY2KEY_CONFIG_HPP
+#define JOY2KEY_CONFIG_HPP
+
+// text configuration of joy2key: joystick and button names, profiles and their bindings
+//
+// Line based, '#' starts a comment, joysticks and buttons are numbered starting with 1:
+//
+//   long press time = 500                 default long press time (ms) of all profiles
+//
+//   [joystick 1]
+//   name = Throttle                       display name of joystick 1
+//   button 3 = Boat switch fwd            display name of button 3, usable in the bindings
+//
+//   [profile Flight]                      profiles in this order, the first one is active at start
+//   long press time = 400                 default long press time of this profile
+//   long press time 1.3 = 800             long press time of joystick 1, button 3
+//   1.1 press = gear up: LShift + A       action on press, release (immediate mode),
+//   1.1 release = gear down: RCtrl + T    short or long (timed mode) of joystick 1, button 1
+//   1.Boat switch fwd long = trim: F10    buttons by number or by display name
+//   1.5 press = ground: F1, F2 -> Ground  key strokes in this order, then switch to profile Ground
+//
+// The action name before ':' is optional. A key stroke is a key, optionally preceded by
+// modifiers (LShift, RShift, Shift, LCtrl, RCtrl, Ctrl, LAlt, RAlt, Alt, LWin, RWin), joined
+// by '+'. Keys: A ... Z, 0 ... 9, F1 ... F24, Num0 ... Num9, Esc, Tab, Space, Enter, Backspace,
+// Insert, Delete, Home, End, PgUp, PgDn, Up, Down, Left, Right, Pause, Print, CapsLock,
+// NumLock, ScrollLock, the modifiers themselves, or a virtual key code like 0x6B.
+
+#include "joy2key/joy2key_binding.hpp"
+
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hd
+{
+namespace j2k
+{
+
+struct ButtonName // display name of a button
+{
+    unsigned int joystick{0}; // jsIdx
+    unsigned int button{0};   // 0-based
+    std::string name;
+};
+
+struct Config // contents of a configuration
+{
+    std::vector<std::string> joysticks; // display name of each joystick (jsIdx), empty if unnamed
+    std::vector<ButtonName> buttons;    // display names of the buttons
+    std::vector<Profile> profiles;      // the first one is active at start
+};
+
+// read a configuration, errors are reported with source and line number
+// returns false (config unchanged) on errors
+bool parseConfig(std::istream &in, const std::string &source, Config &config);
+
+bool readConfig(const std::string &path, Config &config); // parseConfig() of a file
+
+// key strokes like "LShift + A, F10", false if a key is unknown
+bool parseKeys(std::string_view text, std::vector<KeyStroke> &keys);
+
+} // namespace j2k
+} // namespace hd
+
+#endif // JOY2KEY_CONFIG_HPP
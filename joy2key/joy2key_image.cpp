@@ -0,0 +1,480 @@
+// author: Daniel Hug, 2022
+
+#include "joy2key_image.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <ostream>
+#include <system_error>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// anonymous namespace for things to be kept private to this translation unit
+
+using namespace hd::j2k;
+
+std::uint32_t hash(const unsigned char *data, std::size_t size) // FNV-1a
+{
+    std::uint32_t result = 2166136261u;
+    for (std::size_t i = 0; i < size; ++i)
+        result = (result ^ data[i]) * 16777619u;
+    return result;
+}
+
+// header of an image in the layout of this build
+ImageHeader makeHeader()
+{
+    ImageHeader header{};
+    std::memcpy(header.magic, "J2KI", 4);
+    header.version = ImageHeader::current;
+    header.nJoystick = hd::js::max_nJoystick;
+    header.nButton = hd::js::max_nButton;
+    header.nEdge = nEdge;
+    return header;
+}
+
+// an image under construction
+class ImageWriter
+{
+  public:
+    ImageWriter() : m_data(sizeof(ImageHeader)), m_strings(1, '\0')
+    {
+    }
+
+    std::size_t reserve(std::size_t size) // 8 byte aligned section of size bytes, returns its offset
+    {
+        const std::size_t offset = (m_data.size() + 7) & ~std::size_t{7};
+        m_data.resize(offset + size);
+        return offset;
+    }
+
+    std::size_t append(const void *data, std::size_t size)
+    {
+        const std::size_t offset = reserve(size);
+        if (size != 0)
+            std::memcpy(m_data.data() + offset, data, size);
+        return offset;
+    }
+
+    template <typename T>
+    void put(std::size_t offset, const T &record)
+    {
+        std::memcpy(m_data.data() + offset, &record, sizeof(T));
+    }
+
+    std::uint32_t string(const char *text) // offset of a string in the string table
+    {
+        if (*text == '\0')
+            return 0;
+        const std::size_t offset = m_strings.size();
+        m_strings.insert(m_strings.end(), text, text + std::strlen(text) + 1);
+        return static_cast<std::uint32_t>(offset);
+    }
+
+    std::vector<unsigned char> finish(ImageHeader header) // append the string table, fill in the header
+    {
+        header.strings = static_cast<std::uint32_t>(append(m_strings.data(), m_strings.size()));
+        header.nString = static_cast<std::uint32_t>(m_strings.size());
+        m_data.resize((m_data.size() + 7) & ~std::size_t{7});
+        if (m_data.size() > std::numeric_limits<std::uint32_t>::max())
+            return {};
+
+        header.size = static_cast<std::uint32_t>(m_data.size());
+        header.checksum = hash(m_data.data() + sizeof(ImageHeader), m_data.size() - sizeof(ImageHeader));
+        put(0, header);
+        return std::move(m_data);
+    }
+
+  private:
+    std::vector<unsigned char> m_data;
+    std::vector<char> m_strings;
+};
+
+// count records of size bytes at offset, aligned to align, within an image of size imageSize
+bool inside(std::uint64_t offset, std::uint64_t count, std::uint64_t size, std::uint64_t align, std::uint64_t imageSize)
+{
+    return offset % align == 0 && offset <= imageSize && count * size <= imageSize - offset;
+}
+
+// all count values of a section (checked by inside()) are below limit
+template <typename T>
+bool below(const unsigned char *data, std::uint32_t offset, std::size_t count, std::uint64_t limit)
+{
+    const T *values = reinterpret_cast<const T *>(data + offset);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (values[i] >= limit)
+            return false;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+namespace hd
+{
+
+std::ostream &err();
+
+namespace j2k
+{
+
+////////////////////////////////////////////////////////////
+ProfileImage::~ProfileImage()
+{
+#if defined(_WIN32)
+    UnmapViewOfFile(m_data);
+#else
+    munmap(const_cast<unsigned char *>(m_data), m_size);
+#endif
+}
+
+////////////////////////////////////////////////////////////
+std::shared_ptr<const ProfileImage> ProfileImage::open(const std::string &sourcePath, const std::string &imagePath)
+{
+    namespace fs = std::filesystem;
+
+    // use the image as long as the configuration has not been changed since it was compiled:
+    // the stamp is taken before reading, a change while compiling is found by the next start
+    std::error_code error;
+    ImageSource source;
+    const bool haveSource = readSource(sourcePath, source);
+    if (fs::exists(imagePath, error))
+    {
+        auto image = map(imagePath);
+        if (image && (!haveSource || image->getSource() == source))
+            return image;
+    }
+    if (!haveSource)
+    {
+        err() << "Missing joy2key configuration " << sourcePath << std::endl;
+        return nullptr;
+    }
+
+    Config config;
+    if (!readConfig(sourcePath, config))
+        return nullptr;
+
+    const std::vector<unsigned char> image = compile(config, source);
+    if (image.empty() || !write(imagePath, image))
+        return nullptr;
+
+    return map(imagePath);
+}
+
+////////////////////////////////////////////////////////////
+std::shared_ptr<const ProfileImage> ProfileImage::map(const std::string &path)
+{
+    const unsigned char *data = nullptr;
+    std::size_t size = 0;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= static_cast<LONGLONG>(sizeof(ImageHeader)))
+    {
+        size = static_cast<std::size_t>(fileSize.QuadPart);
+        if (HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL))
+        {
+            // the view keeps the mapping alive
+            data = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+
+    if (!data)
+        return nullptr;
+#else
+    const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return nullptr;
+
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(ImageHeader)))
+    {
+        size = static_cast<std::size_t>(status.st_size);
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapped != MAP_FAILED)
+            data = static_cast<const unsigned char *>(mapped);
+    }
+    ::close(file);
+
+    if (!data)
+        return nullptr;
+#endif
+
+    std::shared_ptr<const ProfileImage> image(new ProfileImage(data, size));
+    if (!isValid(data, size))
+    {
+        err() << "Ignoring invalid joy2key image " << path << std::endl;
+        return nullptr;
+    }
+    return image;
+}
+
+////////////////////////////////////////////////////////////
+std::vector<unsigned char> ProfileImage::compile(const Config &config, const ImageSource &source)
+{
+    if (config.profiles.size() > std::numeric_limits<std::uint16_t>::max())
+    {
+        err() << "Too many profiles." << std::endl;
+        return {};
+    }
+
+    ImageWriter writer;
+    ImageHeader header = makeHeader();
+    header.nProfile = static_cast<std::uint16_t>(config.profiles.size());
+    header.sourceTime = source.time;
+    header.sourceSize = source.size;
+    header.profiles = static_cast<std::uint32_t>(writer.reserve(config.profiles.size() * sizeof(ImageProfile)));
+    header.joysticks = static_cast<std::uint32_t>(writer.reserve(js::max_nJoystick * sizeof(ImageJoystick)));
+
+    for (std::size_t i = 0; i < config.profiles.size(); ++i)
+    {
+        const Profile &source = config.profiles[i];
+        for (const Binding &binding : source.bindings)
+        {
+            if (binding.profile >= static_cast<int>(config.profiles.size()))
+            {
+                err() << "Profile \"" << source.name << "\", action \"" << binding.name
+                      << "\": switches to profile " << binding.profile << ", which does not exist." << std::endl;
+                return {};
+            }
+        }
+
+        BindingTable table;
+        if (!table.compile(source))
+            return {};
+
+        // the arrays as compiled, the action names moved into the string table of the image
+        const BindingTable::Arrays &arrays = table.arrays();
+        std::vector<std::uint32_t> names(arrays.nAction);
+        for (std::size_t action = 0; action < arrays.nAction; ++action)
+            names[action] = writer.string(arrays.strings + arrays.names[action]);
+
+        ImageProfile profile{};
+        profile.name = writer.string(source.name.c_str());
+        profile.longPressTime = static_cast<std::uint32_t>(source.longPressTime.count());
+        profile.slots = static_cast<std::uint32_t>(writer.append(arrays.slots, BindingTable::nSlot * sizeof(std::uint16_t)));
+        profile.longPress = static_cast<std::uint32_t>(
+            writer.append(arrays.longPress, BindingTable::nButtonSlot * sizeof(std::uint32_t)));
+        profile.actions = static_cast<std::uint32_t>(writer.append(arrays.actions, arrays.nAction * sizeof(Action)));
+        profile.nAction = static_cast<std::uint32_t>(arrays.nAction);
+        profile.keys = static_cast<std::uint32_t>(writer.append(arrays.keys, arrays.nKey * sizeof(KeyStroke)));
+        profile.nKey = static_cast<std::uint32_t>(arrays.nKey);
+        profile.names = static_cast<std::uint32_t>(writer.append(names.data(), names.size() * sizeof(std::uint32_t)));
+        writer.put(header.profiles + i * sizeof(ImageProfile), profile);
+    }
+
+    for (unsigned int jsIdx = 0; jsIdx < js::max_nJoystick; ++jsIdx)
+    {
+        ImageJoystick joystick{};
+        if (jsIdx < config.joysticks.size())
+            joystick.name = writer.string(config.joysticks[jsIdx].c_str());
+
+        std::vector<std::uint32_t> buttons(js::max_nButton, 0);
+        bool named = false;
+        for (const ButtonName &button : config.buttons)
+        {
+            if (button.joystick == jsIdx && button.button < js::max_nButton)
+            {
+                buttons[button.button] = writer.string(button.name.c_str());
+                named = true;
+            }
+        }
+        if (named)
+            joystick.buttons = static_cast<std::uint32_t>(writer.append(buttons.data(), buttons.size() * sizeof(std::uint32_t)));
+        writer.put(header.joysticks + jsIdx * sizeof(ImageJoystick), joystick);
+    }
+
+    std::vector<unsigned char> image = writer.finish(header);
+    if (image.empty())
+        err() << "The joy2key image exceeds 4 GB." << std::endl;
+    return image;
+}
+
+////////////////////////////////////////////////////////////
+bool ProfileImage::write(const std::string &path, const std::vector<unsigned char> &image)
+{
+    // write a temporary file and replace the old one with it, so the image is never left half written
+    const std::string temporary = path + ".tmp";
+    std::FILE *file = std::fopen(temporary.c_str(), "wb");
+
+    if (!file)
+    {
+        err() << "Failed to create joy2key image " << temporary << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    const bool written = (std::fwrite(image.data(), 1, image.size(), file) == image.size());
+
+    if ((std::fclose(file) != 0) || !written)
+    {
+        err() << "Failed to write joy2key image " << temporary << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+
+    if (error)
+    {
+        err() << "Failed to replace joy2key image " << path << ": " << error.message() << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+bool ProfileImage::isValid(const unsigned char *data, std::size_t size)
+{
+    if (size < sizeof(ImageHeader))
+        return false;
+
+    ImageHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    // written by a build with the same layout of the binding tables
+    const ImageHeader expected = makeHeader();
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+        header.nJoystick != expected.nJoystick || header.nButton != expected.nButton || header.nEdge != expected.nEdge ||
+        header.size != size || hash(data + sizeof(ImageHeader), size - sizeof(ImageHeader)) != header.checksum)
+        return false;
+
+    // sections within the image
+    if (!inside(header.profiles, header.nProfile, sizeof(ImageProfile), 8, size) ||
+        !inside(header.joysticks, js::max_nJoystick, sizeof(ImageJoystick), 8, size) ||
+        !inside(header.strings, header.nString, 1, 1, size) || header.nString == 0 ||
+        data[header.strings] != '\0' || data[header.strings + header.nString - 1] != '\0')
+        return false;
+
+    for (unsigned int i = 0; i < header.nProfile; ++i)
+    {
+        ImageProfile profile;
+        std::memcpy(&profile, data + header.profiles + i * sizeof(ImageProfile), sizeof(profile));
+        if (profile.name >= header.nString || profile.nAction == 0 ||
+            profile.nAction > std::numeric_limits<std::uint16_t>::max() + 1u ||
+            !inside(profile.slots, BindingTable::nSlot, sizeof(std::uint16_t), alignof(std::uint16_t), size) ||
+            !inside(profile.longPress, BindingTable::nButtonSlot, sizeof(std::uint32_t), alignof(std::uint32_t), size) ||
+            !inside(profile.actions, profile.nAction, sizeof(Action), alignof(Action), size) ||
+            !inside(profile.keys, profile.nKey, sizeof(KeyStroke), alignof(KeyStroke), size) ||
+            !inside(profile.names, profile.nAction, sizeof(std::uint32_t), alignof(std::uint32_t), size))
+            return false;
+
+        // the checksum does not protect against a faulty writer: indices and offsets within range
+        if (!below<std::uint16_t>(data, profile.slots, BindingTable::nSlot, profile.nAction) ||
+            !below<std::uint32_t>(data, profile.names, profile.nAction, header.nString))
+            return false;
+
+        const Action *actions = reinterpret_cast<const Action *>(data + profile.actions);
+        for (std::size_t action = 0; action < profile.nAction; ++action)
+        {
+            if (std::uint64_t{actions[action].firstKey} + actions[action].nKey > profile.nKey ||
+                actions[action].profile < -1 || actions[action].profile >= header.nProfile)
+                return false;
+        }
+    }
+
+    for (unsigned int jsIdx = 0; jsIdx < js::max_nJoystick; ++jsIdx)
+    {
+        ImageJoystick joystick;
+        std::memcpy(&joystick, data + header.joysticks + jsIdx * sizeof(ImageJoystick), sizeof(joystick));
+        if (joystick.name >= header.nString ||
+            (joystick.buttons != 0 &&
+             (!inside(joystick.buttons, js::max_nButton, sizeof(std::uint32_t), alignof(std::uint32_t), size) ||
+              !below<std::uint32_t>(data, joystick.buttons, js::max_nButton, header.nString))))
+            return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+bool ProfileImage::readSource(const std::string &path, ImageSource &source)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    const fs::file_time_type time = fs::last_write_time(path, error);
+    if (error)
+        return false;
+    const std::uintmax_t size = fs::file_size(path, error);
+    if (error)
+        return false;
+
+    source.time = static_cast<std::int64_t>(time.time_since_epoch().count());
+    source.size = static_cast<std::uint64_t>(size);
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+BindingTable::Arrays ProfileImage::arrays(unsigned int index) const
+{
+    const ImageProfile &record = profile(index);
+
+    BindingTable::Arrays arrays;
+    arrays.slots = reinterpret_cast<const std::uint16_t *>(m_data + record.slots);
+    arrays.longPress = reinterpret_cast<const std::uint32_t *>(m_data + record.longPress);
+    arrays.actions = reinterpret_cast<const Action *>(m_data + record.actions);
+    arrays.nAction = record.nAction;
+    arrays.keys = reinterpret_cast<const KeyStroke *>(m_data + record.keys);
+    arrays.nKey = record.nKey;
+    arrays.names = reinterpret_cast<const std::uint32_t *>(m_data + record.names);
+    arrays.strings = string(0);
+    arrays.nString = header().nString;
+    return arrays;
+}
+
+////////////////////////////////////////////////////////////
+const char *ProfileImage::getProfileName(unsigned int index) const
+{
+    return string(profile(index).name);
+}
+
+////////////////////////////////////////////////////////////
+std::chrono::milliseconds ProfileImage::getLongPressTime(unsigned int index) const
+{
+    return std::chrono::milliseconds{profile(index).longPressTime};
+}
+
+////////////////////////////////////////////////////////////
+const char *ProfileImage::getJoystickName(unsigned int jsIdx) const
+{
+    return string(reinterpret_cast<const ImageJoystick *>(m_data + header().joysticks)[jsIdx].name);
+}
+
+////////////////////////////////////////////////////////////
+const char *ProfileImage::getButtonName(unsigned int jsIdx, unsigned int button) const
+{
+    const ImageJoystick &joystick = reinterpret_cast<const ImageJoystick *>(m_data + header().joysticks)[jsIdx];
+    if (joystick.buttons == 0)
+        return string(0);
+    return string(reinterpret_cast<const std::uint32_t *>(m_data + joystick.buttons)[button]);
+}
+
+} // namespace j2k
+} // namespace hd
@@ -0,0 +1,164 @@
+// author: Daniel Hug, 2022
+
+#ifndef JOY2KEY_IMAGE_HPP
+#define JOY2KEY_IMAGE_HPP
+
+// compiled configuration of joy2key, mapped into memory
+//
+// The text configuration (see joy2key_config.hpp) is compiled into a binary image that holds
+// the arrays of the binding tables of all profiles as they are used by BindingTable, plus a
+// string table with the names and the long press times. The image is mapped read only and
+// used in place: starting joy2key does not parse anything, it only validates the image. The
+// header records the modification time and size of the text configuration it was compiled
+// from, the image is recompiled when either of them differs (the configuration was changed or
+// replaced, even by an older file).
+//
+// Image layout, in the byte order of the writing machine: an ImageHeader followed by
+// sections aligned to 8 bytes. All references are byte offsets from the start of the image
+// (position independent), the string table holds nul terminated UTF-8 strings starting
+// with the empty one (offset 0 within the table: no name). An image is only used if header,
+// size and checksum are valid, it was written by a build of the same capacities and all
+// indices and offsets stored in its sections are within range.
+
+#include "joy2key/joy2key_binding.hpp"
+#include "joy2key/joy2key_config.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hd
+{
+namespace j2k
+{
+
+struct ImageHeader
+{
+    char magic[4];            // "J2KI"
+    std::uint32_t version;    // ImageHeader::current
+    std::uint16_t nJoystick;  // js::max_nJoystick of the writing build
+    std::uint16_t nButton;    // js::max_nButton of the writing build
+    std::uint16_t nEdge;      // nEdge of the writing build
+    std::uint16_t nProfile;   // number of ImageProfile records
+    std::uint32_t size;       // size of the image in bytes
+    std::uint32_t checksum;   // FNV-1a of the image after the header
+    std::uint32_t profiles;   // offset of nProfile ImageProfile records
+    std::uint32_t joysticks;  // offset of nJoystick ImageJoystick records
+    std::uint32_t strings;    // offset of the string table
+    std::uint32_t nString;    // size of the string table in bytes
+    std::int64_t sourceTime;  // modification time of the text configuration (ticks of its file clock)
+    std::uint64_t sourceSize; // size of the text configuration in bytes
+    enum
+    {
+        current = 2
+    };
+};
+
+struct ImageSource // the text configuration an image was compiled from, as recorded in ImageHeader
+{
+    std::int64_t time{0};
+    std::uint64_t size{0};
+
+    friend bool operator==(const ImageSource &, const ImageSource &) = default;
+};
+
+struct ImageProfile
+{
+    std::uint32_t name;          // name of the profile in the string table
+    std::uint32_t longPressTime; // default long press time of the profile in ms
+    std::uint32_t slots;         // offset of BindingTable::nSlot action indices (std::uint16_t)
+    std::uint32_t longPress;     // offset of BindingTable::nButtonSlot long press times (std::uint32_t)
+    std::uint32_t actions;       // offset of nAction Action records
+    std::uint32_t nAction;
+    std::uint32_t keys;          // offset of nKey KeyStroke records
+    std::uint32_t nKey;
+    std::uint32_t names;         // offset of nAction action names in the string table (std::uint32_t)
+    std::uint32_t reserved;      // 0
+};
+
+struct ImageJoystick
+{
+    std::uint32_t name;    // display name of the joystick in the string table
+    std::uint32_t buttons; // offset of nButton display names in the string table (std::uint32_t), 0 if none
+};
+
+static_assert(sizeof(ImageHeader) == 56, "unexpected padding of ImageHeader");
+static_assert(sizeof(ImageProfile) == 40, "unexpected padding of ImageProfile");
+static_assert(sizeof(ImageJoystick) == 8, "unexpected padding of ImageJoystick");
+static_assert(sizeof(Action) == 8 && sizeof(KeyStroke) == 4, "unexpected padding of the binding records");
+
+class ProfileImage
+{
+  public:
+    ~ProfileImage(); // unmaps the image
+
+    ProfileImage(const ProfileImage &) = delete;
+    ProfileImage &operator=(const ProfileImage &) = delete;
+
+    // map the image at imagePath, compiled from the text configuration at sourcePath before if the image
+    // is missing, invalid or was compiled from another version of the configuration; nullptr if the
+    // configuration has errors
+    static std::shared_ptr<const ProfileImage> open(const std::string &sourcePath, const std::string &imagePath);
+
+    static std::shared_ptr<const ProfileImage> map(const std::string &path); // nullptr if missing or invalid
+
+    // image of a configuration read from source, empty if a profile fails to compile or the image would exceed 4 GB
+    static std::vector<unsigned char> compile(const Config &config, const ImageSource &source = {});
+
+    static bool write(const std::string &path, const std::vector<unsigned char> &image); // replaces path
+
+    static bool isValid(const unsigned char *data, std::size_t size); // header, checksum, sections and contents
+
+    static bool readSource(const std::string &path, ImageSource &source); // false if path does not exist
+
+    ImageSource getSource() const
+    {
+        return {header().sourceTime, header().sourceSize};
+    }
+
+    unsigned int getProfileCount() const
+    {
+        return header().nProfile;
+    }
+
+    BindingTable::Arrays arrays(unsigned int profile) const; // arrays of the binding table of a profile
+
+    const char *getProfileName(unsigned int profile) const;
+
+    std::chrono::milliseconds getLongPressTime(unsigned int profile) const; // default of the profile
+
+    const char *getJoystickName(unsigned int jsIdx) const; // display names, "" if none is configured
+
+    const char *getButtonName(unsigned int jsIdx, unsigned int button) const;
+
+  private:
+    ProfileImage(const unsigned char *data, std::size_t size) : m_data(data), m_size(size)
+    {
+    }
+
+    const ImageHeader &header() const
+    {
+        return *reinterpret_cast<const ImageHeader *>(m_data);
+    }
+
+    const ImageProfile &profile(unsigned int index) const
+    {
+        return reinterpret_cast<const ImageProfile *>(m_data + header().profiles)[index];
+    }
+
+    const char *string(std::uint32_t offset) const
+    {
+        return reinterpret_cast<const char *>(m_data + header().strings) + offset;
+    }
+
+    const unsigned char *m_data; // mapped image
+    std::size_t m_size;          // size of the mapping
+};
+
+} // namespace j2k
+} // namespace hd
+
+#endif // JOY2KEY_IMAGE_HPP
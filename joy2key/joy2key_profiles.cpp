@@ -0,0 +1,125 @@
+// author: Daniel Hug, 2022
+
+#include "joy2key_profiles.hpp"
+#include "joy2key_image.hpp"
+
+#include <ostream>
+
+namespace hd
+{
+
+std::ostream &err();
+
+namespace j2k
+{
+
+////////////////////////////////////////////////////////////
+ProfileSet::ProfileSet() : m_current(std::make_unique<Generation>())
+{
+    m_current->tables.resize(1);
+    m_current->selections.push_back({m_current.get(), &m_current->tables[0], 0});
+    m_active.store(&m_current->selections[0]);
+}
+
+////////////////////////////////////////////////////////////
+ProfileSet::~ProfileSet() = default;
+
+////////////////////////////////////////////////////////////
+bool ProfileSet::load(const std::vector<Profile> &profiles, unsigned int initial)
+{
+    if (initial >= profiles.size())
+    {
+        err() << "Profile " << initial << " to start with does not exist." << std::endl;
+        return false;
+    }
+
+    // compile the new generation before touching the published one
+    auto generation = std::make_unique<Generation>();
+    generation->tables.resize(profiles.size());
+    for (std::size_t i = 0; i < profiles.size(); ++i)
+    {
+        for (const Binding &binding : profiles[i].bindings)
+        {
+            if (binding.profile >= static_cast<int>(profiles.size()))
+            {
+                err() << "Profile \"" << profiles[i].name << "\", action \"" << binding.name
+                      << "\": switches to profile " << binding.profile << ", which does not exist." << std::endl;
+                return false;
+            }
+        }
+        if (!generation->tables[i].compile(profiles[i]))
+            return false;
+    }
+
+    publish(std::move(generation), initial);
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+bool ProfileSet::load(std::shared_ptr<const ProfileImage> image, unsigned int initial)
+{
+    if (initial >= image->getProfileCount())
+    {
+        err() << "Profile " << initial << " to start with does not exist." << std::endl;
+        return false;
+    }
+
+    // views of the tables in the image, nothing is compiled or copied
+    auto generation = std::make_unique<Generation>();
+    generation->tables.reserve(image->getProfileCount());
+    for (unsigned int i = 0; i < image->getProfileCount(); ++i)
+        generation->tables.emplace_back(image->arrays(i));
+    generation->image = std::move(image);
+
+    publish(std::move(generation), initial);
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+void ProfileSet::publish(std::unique_ptr<Generation> generation, unsigned int initial)
+{
+    generation->selections.reserve(generation->tables.size());
+    for (unsigned int i = 0; i < generation->tables.size(); ++i)
+        generation->selections.push_back({generation.get(), &generation->tables[i], i});
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // publish, the dispatch thread may still use the old generation until its next quiescent()
+    m_active.store(&generation->selections[initial], std::memory_order_seq_cst);
+    m_retired.emplace_back(m_epoch.load(std::memory_order_seq_cst), std::move(m_current));
+    m_current = std::move(generation);
+
+    reclaim();
+}
+
+////////////////////////////////////////////////////////////
+void ProfileSet::request(unsigned int profile)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (profile < m_current->selections.size())
+        m_active.store(&m_current->selections[profile], std::memory_order_release);
+
+    reclaim();
+}
+
+////////////////////////////////////////////////////////////
+void ProfileSet::select(unsigned int profile)
+{
+    // the generation of the active selection cannot be reclaimed before our next quiescent(),
+    // if load() publishes a new one meanwhile the swap fails and load() wins
+    const Selection *active = m_active.load(std::memory_order_acquire);
+    if (profile < active->generation->selections.size())
+        m_active.compare_exchange_strong(active, &active->generation->selections[profile], std::memory_order_acq_rel);
+}
+
+////////////////////////////////////////////////////////////
+void ProfileSet::reclaim()
+{
+    // a generation retired at epoch e is unreachable once the dispatch thread called quiescent() after it
+    const std::uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+    std::erase_if(m_retired, [epoch](const auto &retired) { return retired.first < epoch; });
+}
+
+} // namespace j2k
+} // namespace hd
@@ -0,0 +1,111 @@
+// author: Daniel Hug, 2022
+
+#ifndef JOY2KEY_PROFILES_HPP
+#define JOY2KEY_PROFILES_HPP
+
+// the profiles of joy2key and the active one
+//
+// load() compiles all profiles ahead of time into immutable binding tables (a generation)
+// and publishes it. The active profile is a single atomic pointer to a preallocated
+// selection record of the current generation: switching the profile is one pointer swap,
+// the dispatch thread never takes a lock or allocates. A generation replaced by load()
+// is reclaimed once the dispatch thread has passed quiescent() after the swap. The tables
+// of a ProfileImage are used in place, the image stays mapped while they are in use.
+
+#include "joy2key/joy2key_binding.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace hd
+{
+namespace j2k
+{
+
+class ProfileImage;
+
+class ProfileSet
+{
+  public:
+    ProfileSet(); // a single profile without bindings
+
+    ~ProfileSet();
+
+    ProfileSet(const ProfileSet &) = delete;
+    ProfileSet &operator=(const ProfileSet &) = delete;
+
+    // compile all profiles and make profile initial the active one
+    // returns false (profiles unchanged) if a profile fails to compile or switches to an unknown profile
+    // (from any thread but the dispatch thread)
+    bool load(const std::vector<Profile> &profiles, unsigned int initial = 0);
+
+    // use the profiles of a compiled image and make profile initial the active one
+    // returns false (profiles unchanged) if there is no profile initial (from any thread but the dispatch thread)
+    bool load(std::shared_ptr<const ProfileImage> image, unsigned int initial = 0);
+
+    // make profile the active one, ignored if there is no such profile (from any thread but the dispatch thread)
+    void request(unsigned int profile);
+
+    // the functions below are only to be called from the dispatch thread
+
+    const BindingTable &table() const // bindings of the active profile, valid until quiescent()
+    {
+        return *m_active.load(std::memory_order_acquire)->table;
+    }
+
+    unsigned int getActiveProfile() const
+    {
+        return m_active.load(std::memory_order_acquire)->profile;
+    }
+
+    unsigned int getProfileCount() const
+    {
+        return static_cast<unsigned int>(m_active.load(std::memory_order_acquire)->generation->tables.size());
+    }
+
+    // make profile the active one, ignored if there is no such profile
+    // the table() obtained before stays valid until quiescent()
+    void select(unsigned int profile);
+
+    void quiescent() // the dispatch thread holds no reference into the tables anymore
+    {
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+  private:
+    struct Generation;
+
+    struct Selection // preallocated record of an active profile
+    {
+        const Generation *generation{nullptr};
+        const BindingTable *table{nullptr};
+        unsigned int profile{0};
+    };
+
+    struct Generation // compiled profiles, immutable once published
+    {
+        std::vector<BindingTable> tables;
+        std::vector<Selection> selections;         // one per profile
+        std::shared_ptr<const ProfileImage> image; // mapping viewed by the tables, if any
+    };
+
+    void publish(std::unique_ptr<Generation> generation, unsigned int initial); // make generation the current one
+
+    void reclaim(); // delete the retired generations the dispatch thread cannot reference anymore
+
+    std::atomic<const Selection *> m_active; // active profile of the current generation
+    std::atomic<std::uint64_t> m_epoch{0};   // incremented by quiescent()
+
+    std::mutex m_mutex;                      // serializes load() and request()
+    std::unique_ptr<Generation> m_current;   // current generation
+    std::vector<std::pair<std::uint64_t, std::unique_ptr<Generation>>> m_retired; // with the epoch of retirement
+};
+
+} // namespace j2k
+} // namespace hd
+
+#endif // JOY2KEY_PROFILES_HPP
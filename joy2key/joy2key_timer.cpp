@@ -0,0 +1,131 @@
+// author: Daniel Hug, 2022
+
+#include "joy2key_timer.hpp"
+
+namespace hd
+{
+namespace j2k
+{
+
+static_assert(PressTimer::nButtonSlot <= 0xffff, "button ids of PressTimer must fit 16 bits");
+
+////////////////////////////////////////////////////////////
+PressTimer::PressTimer() : m_pos(nButtonSlot, 0)
+{
+    // at most one deadline per button: arming never allocates
+    m_heap.reserve(nButtonSlot);
+}
+
+////////////////////////////////////////////////////////////
+void PressTimer::arm(unsigned int jsIdx, unsigned int button, Clock::time_point deadline)
+{
+    const std::size_t id = std::size_t{jsIdx} * js::max_nButton + button;
+    if (m_pos[id] != 0)
+        remove(m_pos[id] - 1);
+
+    m_heap.push_back({deadline, static_cast<std::uint16_t>(id)});
+    m_pos[id] = static_cast<std::uint16_t>(m_heap.size());
+    siftUp(m_heap.size() - 1);
+}
+
+////////////////////////////////////////////////////////////
+bool PressTimer::cancel(unsigned int jsIdx, unsigned int button)
+{
+    const std::size_t id = std::size_t{jsIdx} * js::max_nButton + button;
+    if (m_pos[id] == 0)
+        return false;
+
+    remove(m_pos[id] - 1);
+    return true;
+}
+
+////////////////////////////////////////////////////////////
+void PressTimer::cancel(unsigned int jsIdx)
+{
+    // drop the entries of the joystick, then rebuild the heap from the rest
+    std::size_t n = 0;
+    for (const Entry &entry : m_heap)
+    {
+        if (entry.id / js::max_nButton == jsIdx)
+            m_pos[entry.id] = 0;
+        else
+            place(n++, entry);
+    }
+    if (n == m_heap.size())
+        return;
+
+    m_heap.resize(n);
+    for (std::size_t pos = n / 2; pos-- > 0;)
+        siftDown(pos);
+}
+
+////////////////////////////////////////////////////////////
+void PressTimer::clear()
+{
+    for (const Entry &entry : m_heap)
+        m_pos[entry.id] = 0;
+    m_heap.clear();
+}
+
+////////////////////////////////////////////////////////////
+void PressTimer::place(std::size_t pos, const Entry &entry)
+{
+    m_heap[pos] = entry;
+    m_pos[entry.id] = static_cast<std::uint16_t>(pos + 1);
+}
+
+////////////////////////////////////////////////////////////
+void PressTimer::siftUp(std::size_t pos)
+{
+    const Entry entry = m_heap[pos];
+    while (pos > 0)
+    {
+        const std::size_t parent = (pos - 1) / 2;
+        if (m_heap[parent].deadline <= entry.deadline)
+            break;
+        place(pos, m_heap[parent]);
+        pos = parent;
+    }
+    place(pos, entry);
+}
+
+////////////////////////////////////////////////////////////
+void PressTimer::siftDown(std::size_t pos)
+{
+    const Entry entry = m_heap[pos];
+    const std::size_t n = m_heap.size();
+    for (;;)
+    {
+        std::size_t child = 2 * pos + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && m_heap[child + 1].deadline < m_heap[child].deadline)
+            ++child;
+        if (entry.deadline <= m_heap[child].deadline)
+            break;
+        place(pos, m_heap[child]);
+        pos = child;
+    }
+    place(pos, entry);
+}
+
+////////////////////////////////////////////////////////////
+void PressTimer::remove(std::size_t pos)
+{
+    m_pos[m_heap[pos].id] = 0;
+
+    const Entry last = m_heap.back();
+    m_heap.pop_back();
+    if (pos == m_heap.size())
+        return;
+
+    // move the last entry into the gap and restore the heap order from there
+    place(pos, last);
+    if (pos > 0 && last.deadline < m_heap[(pos - 1) / 2].deadline)
+        siftUp(pos);
+    else
+        siftDown(pos);
+}
+
+} // namespace j2k
+} // namespace hd
@@ -0,0 +1,102 @@
+// author: Daniel Hug, 2022
+
+#ifndef JOY2KEY_TIMER_HPP
+#define JOY2KEY_TIMER_HPP
+
+// long press deadlines of the buttons in timed mode
+//
+// A button in timed mode arms its deadline when it is pressed and cancels it when it is
+// released. The armed deadlines are kept in a binary min-heap with the heap position of
+// each (joystick, button), so arming and cancelling cost O(log n) and the next deadline
+// is known in O(1), n being the number of held timed buttons (not the number of buttons).
+// Time is passed in by the caller: the timer never reads the clock itself.
+
+#include "di8joy/di8joy.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hd
+{
+namespace j2k
+{
+
+class PressTimer
+{
+  public:
+    using Clock = js::Event::Clock;
+
+    static constexpr std::size_t nButtonSlot = std::size_t{js::max_nJoystick} * js::max_nButton;
+
+    PressTimer();
+
+    // arm the deadline of a button (replaces an armed deadline of the same button)
+    void arm(unsigned int jsIdx, unsigned int button, Clock::time_point deadline);
+
+    // cancel the deadline of a button, false if none was armed (not pressed in timed mode or already expired)
+    bool cancel(unsigned int jsIdx, unsigned int button);
+
+    void cancel(unsigned int jsIdx); // cancel the deadlines of all buttons of a joystick (e.g. unplugged)
+
+    void clear(); // cancel all deadlines
+
+    bool isArmed(unsigned int jsIdx, unsigned int button) const
+    {
+        return m_pos[std::size_t{jsIdx} * js::max_nButton + button] != 0;
+    }
+
+    Clock::time_point deadline(unsigned int jsIdx, unsigned int button) const // Clock::time_point::max() if not armed
+    {
+        const std::uint16_t pos = m_pos[std::size_t{jsIdx} * js::max_nButton + button];
+        return pos != 0 ? m_heap[pos - 1].deadline : Clock::time_point::max();
+    }
+
+    bool empty() const
+    {
+        return m_heap.empty();
+    }
+
+    std::size_t size() const // number of armed deadlines
+    {
+        return m_heap.size();
+    }
+
+    Clock::time_point nextDeadline() const // earliest armed deadline, Clock::time_point::max() if none
+    {
+        return m_heap.empty() ? Clock::time_point::max() : m_heap.front().deadline;
+    }
+
+    // remove the deadlines reached at time now and call expired(jsIdx, button) for each of them,
+    // earliest first
+    template <typename Expired>
+    void expire(Clock::time_point now, Expired expired)
+    {
+        while (!m_heap.empty() && m_heap.front().deadline <= now)
+        {
+            const std::uint16_t id = m_heap.front().id;
+            remove(0);
+            expired(static_cast<unsigned int>(id / js::max_nButton), static_cast<unsigned int>(id % js::max_nButton));
+        }
+    }
+
+  private:
+    struct Entry
+    {
+        Clock::time_point deadline;
+        std::uint16_t id; // jsIdx * js::max_nButton + button
+    };
+
+    void place(std::size_t pos, const Entry &entry); // store entry at pos and update m_pos
+    void siftUp(std::size_t pos);
+    void siftDown(std::size_t pos);
+    void remove(std::size_t pos);
+
+    std::vector<Entry> m_heap;        // armed deadlines, earliest at the front
+    std::vector<std::uint16_t> m_pos; // heap position + 1 of each (joystick, button), 0: not armed
+};
+
+} // namespace j2k
+} // namespace hd
+
+#endif // JOY2KEY_TIMER_HPP
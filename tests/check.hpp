@@ -0,0 +1,39 @@
+// author: Daniel Hug, 2022
+
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+// minimal checks for the test executables: CHECK(condition) reports a failed condition
+// with its location and continues, the executable returns check::result() from main()
+
+#include <atomic>
+#include <iostream>
+
+namespace check
+{
+
+inline std::atomic<unsigned int> failures{0};
+
+inline bool report(bool passed, const char *condition, const char *file, int line)
+{
+    if (!passed)
+    {
+        failures.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << file << "(" << line << "): check failed: " << condition << std::endl;
+    }
+    return passed;
+}
+
+inline int result()
+{
+    const unsigned int failed = failures.load(std::memory_order_relaxed);
+    if (failed != 0)
+        std::cerr << failed << " check(s) failed" << std::endl;
+    return (failed == 0) ? 0 : 1;
+}
+
+} // namespace check
+
+#define CHECK(condition) check::report(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+#endif // CHECK_HPP
@@ -0,0 +1,143 @@
+// author: Daniel Hug, 2022
+
+// decoding of buffered DirectInput events and the growth of the event buffer
+
+#include "di8joy/di8joy_decode.hpp"
+#include "tests/check.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+using hd::js;
+using namespace hd::priv;
+
+namespace
+{
+
+struct ObjectData // the fields of DIDEVICEOBJECTDATA used by the decode
+{
+    unsigned int dwOfs;
+    unsigned int dwData;
+};
+
+// DIJOYSTATE2 offsets (DIJOFS_*)
+constexpr unsigned int ofsX = 0, ofsY = 4, ofsPov0 = 32, ofsButton0 = 48;
+
+void checkGrowth()
+{
+    // no growth while bursts fill at most half of the buffer
+    CHECK(adaptEventBufferSize(min_eventBufferSize, 0, false) == 0);
+    CHECK(adaptEventBufferSize(32, 16, false) == 0);
+    CHECK(adaptEventBufferSize(256, 128, false) == 0);
+
+    // more than half full or overflowed: at least double
+    CHECK(adaptEventBufferSize(32, 17, false) == 64);
+    CHECK(adaptEventBufferSize(32, 32, true) == 64);
+    CHECK(adaptEventBufferSize(64, 3, true) == 128);
+
+    // room for twice a burst larger than the buffer
+    CHECK(adaptEventBufferSize(32, 100, true) == 256);
+
+    // capped at the maximum, no growth beyond it
+    CHECK(adaptEventBufferSize(512, 512, true) == max_eventBufferSize);
+    CHECK(adaptEventBufferSize(768, 1000, true) == max_eventBufferSize);
+    CHECK(adaptEventBufferSize(max_eventBufferSize, max_eventBufferSize, true) == 0);
+
+    // overflowing every time: doubles from the minimum up to the maximum, then stays
+    unsigned int size = min_eventBufferSize;
+    unsigned int steps = 0;
+    for (unsigned int next; (next = adaptEventBufferSize(size, size, true)) != 0; ++steps)
+    {
+        CHECK(next == 2 * size);
+        size = next;
+    }
+    CHECK(size == max_eventBufferSize);
+    CHECK(steps == 5);
+}
+
+void checkDecode()
+{
+    // a stick with X, Y, one pov hat and 12 buttons
+    int axes[js::max_nAxis];
+    int povs[js::max_nPOV];
+    int buttons[js::max_nButton];
+    for (int &axis : axes)
+        axis = -1;
+    for (int &pov : povs)
+        pov = -1;
+    for (int &button : buttons)
+        button = -1;
+    axes[js::X] = ofsX;
+    axes[js::Y] = ofsY;
+    povs[0] = ofsPov0;
+    for (int i = 0; i < 12 && i < js::max_nButton; ++i)
+        buttons[i] = ofsButton0 + i;
+
+    jsDecodeTable table;
+    table.build(axes, povs, buttons);
+
+    // a recorded sequence of buffered events, with the control each one changes
+    struct Step
+    {
+        ObjectData data;
+        jsControl::Kind kind;
+        unsigned char index;
+    };
+
+    const Step steps[] = {
+        {{ofsButton0, 0x80}, jsControl::Button, 0},
+        {{ofsX, 0x7FFF}, jsControl::Axis, js::X},
+        {{ofsY, 0x8000}, jsControl::Axis, js::Y},
+        {{ofsPov0, 9000}, jsControl::Pov, 0},
+        {{ofsButton0 + 11, 0x80}, jsControl::Button, 11},
+        {{ofsButton0, 0x80}, jsControl::None, 0},      // unchanged
+        {{ofsButton0 + 12, 0x80}, jsControl::None, 0}, // button the device does not have
+        {{ofsX + 1, 0x1234}, jsControl::None, 0},      // inside an axis
+        {{400, 0x80}, jsControl::None, 0},             // beyond DIJOYSTATE2
+        {{ofsButton0, 0x00}, jsControl::Button, 0},
+        {{ofsPov0, 0xFFFFFFFF}, jsControl::Pov, 0},
+        {{ofsX, 0x0000}, jsControl::Axis, js::X},
+    };
+
+    jsState state;
+    unsigned int stepIdx = 0;
+    for (const Step &step : steps)
+    {
+        const jsControl control = table.decode(state, step.data.dwOfs, step.data.dwData);
+        if (!CHECK((control.kind == step.kind) && ((step.kind == jsControl::None) || (control.index == step.index))))
+            std::cerr << "  in step " << stepIdx << std::endl;
+        ++stepIdx;
+    }
+
+    CHECK(!state.buttons.test(0));
+    CHECK(state.buttons.test(11));
+    CHECK(!state.buttons.test(12));
+    CHECK(state.axes[js::X] == axisFromRaw16(0));
+    CHECK(state.axes[js::Y] == -js::axisFull);
+    CHECK(state.povs[0] == -1);
+
+    // a snapshot overwrites all mapped controls
+    unsigned char joystate[jsDecodeTable::size]{};
+    const std::int32_t x = 0x7FFF;
+    const std::uint32_t pov = 27000;
+    std::memcpy(joystate + ofsX, &x, sizeof(x));
+    std::memcpy(joystate + ofsPov0, &pov, sizeof(pov));
+    joystate[ofsButton0 + 3] = 0x80;
+
+    table.decodeSnapshot(state, joystate);
+    CHECK(state.axes[js::X] == js::axisFull);
+    CHECK(state.axes[js::Y] == axisFromRaw16(0));
+    CHECK(state.povs[0] == 27000);
+    CHECK(state.buttons.test(3));
+    CHECK(!state.buttons.test(11));
+}
+
+} // anonymous namespace
+
+int main()
+{
+    checkGrowth();
+    checkDecode();
+
+    return check::result();
+}
@@ -0,0 +1,104 @@
+// author: Daniel Hug, 2022
+
+// virtual pov buttons of the positions the backends report (hundredths of a degree)
+
+#include "di8joy/di8joy_decode.hpp"
+#include "tests/check.hpp"
+
+#include <vector>
+
+using hd::js;
+using namespace hd::priv;
+
+int main()
+{
+    // every direction covers +/-22.5 degrees around its angle
+    CHECK(povButton(-1) == js::PovC);
+    CHECK(povButton(0) == js::PovU);
+    CHECK(povButton(2249) == js::PovU);
+    CHECK(povButton(2250) == js::PovUR);
+    CHECK(povButton(33749) == js::PovUL);
+    CHECK(povButton(33750) == js::PovU);
+    CHECK(povButton(35999) == js::PovU);
+    CHECK(povButton(36000) == js::PovC);
+
+    jsCaps caps;
+    caps.nButton = 16;
+    caps.nPOV = 1;
+    const unsigned int base = povButtonBase(caps, 0);
+
+    struct Step
+    {
+        int position;
+        js::PovButton button;
+    };
+
+    const Step steps[] = {{0, js::PovU},      {4500, js::PovUR}, {9000, js::PovR},  {13500, js::PovDR},
+                          {18000, js::PovD},  {22500, js::PovDL}, {27000, js::PovL}, {31500, js::PovUL},
+                          {-1, js::PovC}};
+
+    jsState state;
+    state.connected = true;
+    state.povs[0] = -1;
+    unsigned int previous = js::nPovButton; // just opened: no virtual button pressed yet
+
+    for (const Step &step : steps)
+    {
+        const jsState before = state;
+        state.povs[0] = step.position;
+
+        js::Event moved;
+        moved.type = js::Event::PovMoved;
+        moved.index = 0;
+        moved.position = step.position;
+        std::vector<js::Event> events{moved};
+
+        applyPovButtons(state, before, caps, events);
+
+        for (unsigned int button = 0; button < js::nPovButton; ++button)
+            CHECK(state.buttons.test(base + button) == (button == static_cast<unsigned int>(step.button)));
+
+        // the pov event is followed by the release of the previous and the press of the new virtual button
+        const std::size_t expected = (previous < js::nPovButton) ? 3 : 2;
+        if (CHECK(events.size() == expected))
+        {
+            if (expected == 3)
+            {
+                CHECK(events[1].type == js::Event::ButtonReleased);
+                CHECK(events[1].index == base + previous);
+            }
+            CHECK(events.back().type == js::Event::ButtonPressed);
+            CHECK(events.back().index == base + static_cast<unsigned int>(step.button));
+        }
+
+        previous = step.button;
+    }
+
+    // a resync from a snapshot of all keys (evdev after SYN_DROPPED) keeps the virtual button of a held hat:
+    // the hat did not move, neither a release nor a press of it is reported
+    {
+        jsState held;
+        held.connected = true;
+        held.povs[0] = 9000;
+        std::vector<js::Event> events;
+        applyPovButtons(held, jsState(), caps, events);
+
+        int codes[js::max_nButton];
+        for (unsigned int i = 0; i < js::max_nButton; ++i)
+            codes[i] = (i < caps.nButton) ? static_cast<int>(0x120 + i) : -1;
+
+        jsState resynced = held;
+        setMappedButtons(resynced, codes, [](int code) { return code == 0x120 + 3; });
+        CHECK(resynced.buttons.test(3));
+        CHECK(resynced.buttons.test(base + js::PovR));
+
+        events.clear();
+        appendChangeEvents(events, held, resynced, js::Event::Clock::now(), 0);
+        applyPovButtons(resynced, held, caps, events);
+        if (CHECK(events.size() == 1))
+            CHECK(events[0].type == js::Event::ButtonPressed && events[0].index == 3);
+        CHECK(resynced.buttons.test(base + js::PovR));
+    }
+
+    return check::result();
+}
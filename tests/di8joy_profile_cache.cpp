@@ -0,0 +1,172 @@
+// author: Daniel Hug, 2022
+
+// capability profile cache: round trip through the file format, corrupted files,
+// devices with other ids or names, backend objects beyond the limits of the backend
+
+#include "di8joy/di8joy_profile.hpp"
+#include "tests/check.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using hd::js;
+using namespace hd::priv;
+
+namespace
+{
+
+const jsProfileLimits limits{64, 4, 768}; // ABS_CNT, evdev hats, KEY_CNT
+
+jsProfile makeProfile(std::uint16_t vendorId, std::uint16_t productId, const std::wstring &name)
+{
+    jsProfile profile;
+    profile.vendorId = vendorId;
+    profile.productId = productId;
+    profile.nameHash = jsProfileCache::hash(name);
+    profile.flags = jsProfile::Buffered;
+
+    for (int i = 0; i < js::max_nAxis; ++i)
+    {
+        profile.axes[i] = (i < 4) ? i : -1;
+        profile.axisMin[i] = -32768;
+        profile.axisRange[i] = 65535;
+    }
+    for (int i = 0; i < js::max_nPOV; ++i)
+        profile.povs[i] = (i == 0) ? 0 : -1;
+    for (int i = 0; i < js::max_nButton; ++i)
+        profile.buttons[i] = (i < 16) ? 0x120 + i : -1;
+
+    return profile;
+}
+
+bool equal(const jsProfile &lhs, const jsProfile &rhs)
+{
+    return std::memcmp(&lhs, &rhs, sizeof(jsProfile)) == 0;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    const jsProfile stick = makeProfile(0x044F, 0x0402, L"Stick");
+    const jsProfile throttle = makeProfile(0x044F, 0x0404, L"Throttle");
+
+    jsProfileCache cache(limits);
+    cache.store(stick);
+    cache.store(throttle);
+
+    // round trip
+    const std::vector<unsigned char> data = cache.serialize();
+    {
+        jsProfileCache loaded(limits);
+        CHECK(loaded.deserialize(data.data(), data.size()));
+
+        jsProfile found;
+        CHECK(loaded.find(stick.vendorId, stick.productId, stick.nameHash, found) && equal(found, stick));
+        CHECK(loaded.find(throttle.vendorId, throttle.productId, throttle.nameHash, found) && equal(found, throttle));
+    }
+
+    // round trip through a file
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / "di8joy_profile_cache.j2kp").string();
+        std::remove(path.c_str());
+
+        jsProfileCache saved(limits);
+        CHECK(saved.setFile(path));
+        saved.store(stick);
+
+        jsProfileCache loaded(limits);
+        CHECK(loaded.setFile(path));
+
+        jsProfile found;
+        CHECK(loaded.find(stick.vendorId, stick.productId, stick.nameHash, found) && equal(found, stick));
+
+        std::remove(path.c_str());
+    }
+
+    // a rejected device is refused for the session, but not written to the file
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / "di8joy_profile_cache.j2kp").string();
+        std::remove(path.c_str());
+
+        jsProfile rejected = throttle;
+        rejected.flags = jsProfile::Rejected;
+
+        jsProfileCache saved(limits);
+        CHECK(saved.setFile(path));
+        saved.store(stick);
+        saved.store(rejected);
+
+        jsProfile found;
+        CHECK(saved.find(rejected.vendorId, rejected.productId, rejected.nameHash, found) &&
+              (found.flags & jsProfile::Rejected));
+
+        const std::vector<unsigned char> contents = saved.serialize();
+        CHECK(contents.size() == sizeof(jsProfileHeader) + sizeof(jsProfile));
+
+        jsProfileCache loaded(limits);
+        CHECK(loaded.setFile(path));
+        CHECK(loaded.find(stick.vendorId, stick.productId, stick.nameHash, found));
+        CHECK(!loaded.find(rejected.vendorId, rejected.productId, rejected.nameHash, found));
+
+        std::remove(path.c_str());
+    }
+
+    // corrupted files: truncated, wrong magic, flipped bits in the profiles
+    {
+        jsProfileCache loaded(limits);
+        CHECK(!loaded.deserialize(data.data(), data.size() - 1));
+        CHECK(!loaded.deserialize(data.data(), sizeof(jsProfileHeader) - 1));
+
+        std::vector<unsigned char> corrupted = data;
+        corrupted[0] = 'X';
+        CHECK(!loaded.deserialize(corrupted.data(), corrupted.size()));
+
+        for (std::size_t i = sizeof(jsProfileHeader); i < data.size(); i += 7)
+        {
+            corrupted = data;
+            corrupted[i] ^= 0x10;
+            CHECK(!loaded.deserialize(corrupted.data(), corrupted.size()));
+        }
+
+        // nothing of a rejected file is used
+        jsProfile found;
+        CHECK(!loaded.find(stick.vendorId, stick.productId, stick.nameHash, found));
+    }
+
+    // other devices with the same ids or no ids at all are not found
+    {
+        jsProfile found;
+        CHECK(!cache.find(stick.vendorId, stick.productId, jsProfileCache::hash(std::wstring(L"Other stick")), found));
+        CHECK(!cache.find(stick.vendorId, 0x0403, stick.nameHash, found));
+        CHECK(!cache.find(0, stick.productId, stick.nameHash, found));
+    }
+
+    // backend objects beyond the limits: the file of a valid cache is rejected by a backend with smaller limits
+    {
+        CHECK(cache.isValid(stick));
+
+        jsProfile outOfRange = stick;
+        outOfRange.buttons[0] = limits.button;
+        CHECK(!cache.isValid(outOfRange));
+
+        outOfRange = stick;
+        outOfRange.axes[0] = -2;
+        CHECK(!cache.isValid(outOfRange));
+
+        outOfRange = stick;
+        outOfRange.povs[0] = limits.pov;
+        CHECK(!cache.isValid(outOfRange));
+
+        jsProfileCache smaller({limits.axis, limits.pov, 0x120 + 15});
+        CHECK(!smaller.deserialize(data.data(), data.size()));
+
+        jsProfile found;
+        CHECK(!smaller.find(stick.vendorId, stick.productId, stick.nameHash, found));
+    }
+
+    return check::result();
+}
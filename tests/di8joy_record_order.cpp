@@ -0,0 +1,109 @@
+// author: Daniel Hug, 2022
+
+// a recording holds its records in the order of their time, whatever the order the joysticks
+// were recorded in, no events of a joystick before its connect record and no events of the
+// virtual pov buttons
+
+#include "di8joy/di8joy_record.hpp"
+#include "tests/check.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using hd::js;
+using namespace hd::priv;
+
+namespace
+{
+
+js::Event makeButton(unsigned char joystick, unsigned char index, bool pressed, js::Event::Clock::time_point time)
+{
+    js::Event event;
+    event.type = pressed ? js::Event::ButtonPressed : js::Event::ButtonReleased;
+    event.joystick = joystick;
+    event.index = index;
+    event.time = time;
+    return event;
+}
+
+std::vector<jsRecordEntry> readRecording(const std::string &path)
+{
+    std::vector<jsRecordEntry> entries;
+    if (std::FILE *file = std::fopen(path.c_str(), "rb"))
+    {
+        jsRecordHeader header;
+        jsRecordEntry entry;
+        if (std::fread(&header, sizeof(header), 1, file) == 1)
+        {
+            while (std::fread(&entry, sizeof(entry), 1, file) == 1)
+                entries.push_back(entry);
+        }
+        std::fclose(file);
+    }
+    return entries;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    using std::chrono::milliseconds;
+
+    const std::string path = (std::filesystem::temp_directory_path() / "di8joy_record_order.j2kr").string();
+    const unsigned int nButton = 4; // virtual pov buttons from 4 on
+
+    jsRecorder recorder;
+    if (!CHECK(recorder.start(path)))
+        return check::result();
+    const auto start = js::Event::Clock::now() + milliseconds(100);
+
+    // one update: joystick 0 is recorded before joystick 1, whose events happened earlier
+    recorder.record({makeButton(0, 0, true, start + milliseconds(30)), makeButton(0, 1, true, start + milliseconds(40))},
+                    nButton);
+    recorder.record({makeButton(1, 2, true, start + milliseconds(10)), makeButton(1, 3, true, start + milliseconds(30)),
+                     makeButton(1, nButton, false, start + milliseconds(20))}, // release of a virtual pov button
+                    nButton);
+    recorder.flush();
+
+    // the next update: a device timestamp lagging behind the last record handed over
+    recorder.record({makeButton(1, 2, false, start + milliseconds(35))}, nButton);
+    recorder.flush();
+
+    // a joystick opened asynchronously: its buffered input dates back to before its connect record
+    std::this_thread::sleep_for(milliseconds(200));
+    jsCaps caps;
+    caps.nButton = nButton;
+    recorder.recordConnect(2, caps, js::Id());
+    recorder.record({makeButton(2, 0, true, start + milliseconds(50))}, nButton);
+    recorder.flush();
+    recorder.stop();
+
+    std::vector<jsRecordEntry> entries = readRecording(path);
+    std::remove(path.c_str());
+
+    if (!CHECK(entries.size() == 8))
+        return check::result();
+
+    // connect and identification, then the event at the time of the connect record
+    CHECK(entries[5].joystick == 2 && entries[5].type == jsRecordEntry::Connected);
+    CHECK(entries[6].type == jsRecordEntry::Identified);
+    CHECK(entries[7].joystick == 2 && entries[7].type == js::Event::ButtonPressed && entries[7].time == entries[5].time);
+    entries.resize(5);
+
+    // sorted by time, records at the same time in the order they were recorded
+    const unsigned char order[][2] = {{1, 2}, {0, 0}, {1, 3}, {0, 1}, {1, 2}};
+    for (std::size_t e = 0; e < entries.size(); ++e)
+    {
+        CHECK(entries[e].joystick == order[e][0] && entries[e].index == order[e][1]);
+        if (e > 0)
+            CHECK(entries[e].time >= entries[e - 1].time);
+    }
+
+    // the lagging record is moved up to the last time of the previous update
+    CHECK(entries[4].type == js::Event::ButtonReleased && entries[4].time == entries[3].time);
+
+    return check::result();
+}
@@ -0,0 +1,148 @@
+// author: Daniel Hug, 2022
+
+// writer/reader stress test of the published joystick states
+//
+// A synthetic joystick toggles all of its buttons, axes and its pov hat together every
+// millisecond, so each consistent state has either all buttons pressed, all axes at +50%
+// and the hat right, or all buttons released, all axes at -50% and the hat left.
+// One thread calls update() while several threads read the state: any other combination
+// seen by a reader is a torn state.
+
+#include "di8joy/di8joy.hpp"
+#include "tests/check.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using hd::js;
+
+namespace
+{
+
+constexpr unsigned int nButton = 32;
+constexpr unsigned int nAxis = 4;
+constexpr std::chrono::milliseconds duration{500};
+constexpr unsigned int nReader = 3;
+
+const js::axis_t pressedAxis = js::axisFromPercent(50.f);
+const js::axis_t releasedAxis = js::axisFromPercent(-50.f);
+
+js::Event scriptEvent(js::Event::Type type, unsigned char index, std::chrono::milliseconds time)
+{
+    js::Event event;
+    event.type = type;
+    event.index = index;
+    event.time = js::Event::Clock::time_point(time);
+    return event;
+}
+
+// all controls change at 1 ms (pressed) and at 2 ms (released), repeated in a loop
+std::vector<js::Event> toggleScript()
+{
+    std::vector<js::Event> script;
+
+    for (const bool pressed : {true, false})
+    {
+        const std::chrono::milliseconds time(pressed ? 1 : 2);
+
+        for (unsigned char b = 0; b < nButton; ++b)
+            script.push_back(scriptEvent(pressed ? js::Event::ButtonPressed : js::Event::ButtonReleased, b, time));
+
+        for (unsigned char a = 0; a < nAxis; ++a)
+        {
+            js::Event event = scriptEvent(js::Event::AxisMoved, a, time);
+            event.axisPosition = pressed ? pressedAxis : releasedAxis;
+            script.push_back(event);
+        }
+
+        js::Event event = scriptEvent(js::Event::PovMoved, 0, time);
+        event.position = pressed ? 9000 : 27000;
+        script.push_back(event);
+    }
+
+    return script;
+}
+
+// state before the first script event, or one of the two states of the script
+bool isConsistent(const js::State &state)
+{
+    const bool pressed = state.buttons.test(0);
+
+    for (unsigned int b = 1; b < nButton; ++b)
+    {
+        if (state.buttons.test(b) != pressed)
+            return false;
+    }
+
+    const js::axis_t axis = state.axes[0];
+    for (unsigned int a = 1; a < nAxis; ++a)
+    {
+        if (state.axes[a] != axis)
+            return false;
+    }
+
+    if (pressed)
+        return (axis == pressedAxis) && (state.povs[0] == 9000);
+
+    return ((axis == releasedAxis) && (state.povs[0] == 27000)) || ((axis == js::axis_t{}) && (state.povs[0] == 0));
+}
+
+} // anonymous namespace
+
+int main()
+{
+    js::SyntheticDevice device;
+    device.nButton = nButton;
+    device.nAxis = nAxis;
+    device.nPOV = 1;
+    device.pattern = js::SyntheticDevice::Scripted;
+    device.script = toggleScript();
+
+    js::startSynthetic({device});
+
+    std::atomic<bool> done{false};
+    std::atomic<unsigned long> torn{0};
+    std::atomic<unsigned long> reads{0};
+
+    std::vector<std::thread> readers;
+    for (unsigned int r = 0; r < nReader; ++r)
+    {
+        readers.emplace_back([&] {
+            unsigned long count = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                const js::State state = js::getState(0);
+                if (state.connected && !isConsistent(state))
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                ++count;
+            }
+            reads.fetch_add(count, std::memory_order_relaxed);
+        });
+    }
+
+    const auto end = std::chrono::steady_clock::now() + duration;
+    std::uint64_t firstGeneration = 0;
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+        js::update();
+        if (firstGeneration == 0)
+            firstGeneration = js::getGeneration(0);
+    }
+
+    done.store(true, std::memory_order_relaxed);
+    for (std::thread &reader : readers)
+        reader.join();
+
+    CHECK(js::isConnected(0));
+    CHECK(isConsistent(js::getState(0)));
+    CHECK(js::getGeneration(0) > firstGeneration + 100);
+    CHECK(reads.load() > 0);
+    CHECK(torn.load() == 0);
+
+    js::stopSynthetic();
+
+    return check::result();
+}
@@ -0,0 +1,161 @@
+// author: Daniel Hug, 2022
+
+// a compiled image is only mapped if the indices and offsets in its sections are within range,
+// and it is recompiled whenever the text configuration differs from the one it was compiled from
+
+#include "joy2key/joy2key_image.hpp"
+#include "tests/check.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace hd::j2k;
+
+namespace
+{
+
+Profile makeProfile(const std::string &name)
+{
+    Profile profile;
+    profile.name = name;
+
+    Binding binding;
+    binding.button = 1;
+    binding.name = name + " action";
+    binding.keys = {KeyStroke{LShift, 0, 'A'}, KeyStroke{0, 0, 'B'}};
+    binding.profile = 0;
+    profile.bindings.push_back(binding);
+
+    return profile;
+}
+
+template <typename T>
+T get(const std::vector<unsigned char> &image, std::size_t offset)
+{
+    T record;
+    std::memcpy(&record, image.data() + offset, sizeof(T));
+    return record;
+}
+
+template <typename T>
+void set(std::vector<unsigned char> &image, std::size_t offset, const T &record)
+{
+    std::memcpy(image.data() + offset, &record, sizeof(T));
+}
+
+// image with a section patched and the checksum updated, as a faulty writer would produce it
+template <typename T>
+bool isValidPatched(std::vector<unsigned char> image, std::size_t offset, const T &record)
+{
+    set(image, offset, record);
+
+    std::uint32_t checksum = 2166136261u; // FNV-1a
+    for (std::size_t i = sizeof(ImageHeader); i < image.size(); ++i)
+        checksum = (checksum ^ image[i]) * 16777619u;
+    set(image, offsetof(ImageHeader, checksum), checksum);
+
+    return ProfileImage::isValid(image.data(), image.size());
+}
+
+void checkContents()
+{
+    Config config;
+    config.joysticks = {"Throttle"};
+    config.buttons = {ButtonName{0, 2, "Boat switch fwd"}};
+    config.profiles = {makeProfile("Flight"), makeProfile("Ground")};
+
+    const std::vector<unsigned char> image = ProfileImage::compile(config, ImageSource{123, 45});
+    if (!CHECK(ProfileImage::isValid(image.data(), image.size())))
+        return;
+
+    const auto header = get<ImageHeader>(image, 0);
+    CHECK(header.sourceTime == 123 && header.sourceSize == 45);
+
+    const auto profile = get<ImageProfile>(image, header.profiles);
+    const auto joystick = get<ImageJoystick>(image, header.joysticks);
+    CHECK(profile.nAction == 2 && profile.nKey == 2 && joystick.buttons != 0);
+
+    // the patches themselves keep the image valid
+    CHECK(isValidPatched(image, profile.slots, std::uint16_t(profile.nAction - 1)));
+    CHECK(isValidPatched(image, profile.actions + sizeof(Action), Action{0, 2, 1}));
+
+    // action index beyond the actions
+    CHECK(!isValidPatched(image, profile.slots, std::uint16_t(profile.nAction)));
+
+    // key strokes beyond the keys of the profile
+    CHECK(!isValidPatched(image, profile.actions + sizeof(Action), Action{1, 2, -1}));
+    CHECK(!isValidPatched(image, profile.actions + sizeof(Action), Action{0xFFFFFFFFu, 2, -1}));
+
+    // switch to a profile that does not exist
+    CHECK(!isValidPatched(image, profile.actions + sizeof(Action), Action{0, 2, 2}));
+    CHECK(!isValidPatched(image, profile.actions + sizeof(Action), Action{0, 2, -2}));
+
+    // action and button names beyond the string table
+    CHECK(!isValidPatched(image, profile.names + sizeof(std::uint32_t), header.nString));
+    CHECK(!isValidPatched(image, joystick.buttons + 2 * sizeof(std::uint32_t), header.nString));
+}
+
+bool writeSource(const std::filesystem::path &path, const std::string &profile)
+{
+    std::ofstream out(path, std::ios::trunc);
+    out << "[profile " << profile << "]\n1.1 press = A\n";
+    out.close();
+    return !out.fail();
+}
+
+void checkStaleness()
+{
+    namespace fs = std::filesystem;
+
+    const fs::path source = fs::temp_directory_path() / "joy2key_image.cfg";
+    const std::string image = (fs::temp_directory_path() / "joy2key_image.j2k").string();
+    fs::remove(image);
+
+    if (!CHECK(writeSource(source, "First")))
+        return;
+
+    // compiled from the source, then used as long as the source is unchanged
+    auto compiled = ProfileImage::open(source.string(), image);
+    if (!CHECK(compiled))
+        return;
+    ImageSource stamp;
+    CHECK(ProfileImage::readSource(source.string(), stamp) && compiled->getSource() == stamp);
+    CHECK(std::string(compiled->getProfileName(0)) == "First");
+    compiled.reset();
+
+    auto reused = ProfileImage::open(source.string(), image);
+    CHECK(reused && reused->getSource() == stamp);
+    reused.reset();
+
+    // replaced by a configuration with an older modification time: recompiled
+    const fs::file_time_type time = fs::last_write_time(source);
+    CHECK(writeSource(source, "Second"));
+    fs::last_write_time(source, time - std::chrono::hours(1));
+    auto older = ProfileImage::open(source.string(), image);
+    CHECK(older && std::string(older->getProfileName(0)) == "Second");
+    older.reset();
+
+    // changed with the modification time restored: the size differs, recompiled
+    CHECK(writeSource(source, "Third profile"));
+    fs::last_write_time(source, time - std::chrono::hours(1));
+    auto sameTime = ProfileImage::open(source.string(), image);
+    CHECK(sameTime && std::string(sameTime->getProfileName(0)) == "Third profile");
+    sameTime.reset();
+
+    fs::remove(source);
+    fs::remove(image);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    checkContents();
+    checkStaleness();
+
+    return check::result();
+}
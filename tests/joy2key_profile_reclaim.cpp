@@ -0,0 +1,85 @@
+// author: Daniel Hug, 2022
+
+// a generation of profiles replaced by ProfileSet::load() is only freed after the
+// dispatch thread passed quiescent(): until then the tables it obtained stay usable
+
+#include "joy2key/joy2key_image.hpp"
+#include "joy2key/joy2key_profiles.hpp"
+#include "tests/check.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace hd::j2k;
+
+namespace
+{
+
+Profile makeProfile(const std::string &name, unsigned int nBinding)
+{
+    Profile profile;
+    profile.name = name;
+
+    for (unsigned int b = 0; b < nBinding; ++b)
+    {
+        Binding binding;
+        binding.button = b;
+        binding.name = name;
+        binding.keys = {KeyStroke{0, 0, 'A'}};
+        profile.bindings.push_back(binding);
+    }
+
+    return profile;
+}
+
+} // anonymous namespace
+
+int main()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "joy2key_profile_reclaim.j2k").string();
+
+    Config config;
+    config.profiles = {makeProfile("image", 3)};
+    if (!CHECK(ProfileImage::write(path, ProfileImage::compile(config))))
+        return check::result();
+
+    // the generation of the image holds the last reference to the mapping: it is unmapped when it is freed
+    std::shared_ptr<const ProfileImage> image = ProfileImage::map(path);
+    if (!CHECK(image))
+        return check::result();
+    const std::weak_ptr<const ProfileImage> mapping = image;
+
+    ProfileSet profiles;
+    CHECK(profiles.load(std::move(image)));
+
+    // the dispatch thread takes the table of the image generation in its tick
+    profiles.quiescent();
+    const BindingTable &table = profiles.table();
+    CHECK(table.getActionCount() == 3);
+
+    // another thread loads new profiles meanwhile: the image generation is retired, not freed
+    CHECK(profiles.load({makeProfile("first", 1), makeProfile("second", 2)}));
+    CHECK(profiles.getProfileCount() == 2);
+    CHECK(!mapping.expired());
+
+    // reclaiming without a quiescent() of the dispatch thread keeps it
+    profiles.request(1);
+    CHECK(profiles.load({makeProfile("third", 1)}));
+    CHECK(!mapping.expired());
+    CHECK(table.getActionCount() == 3);
+    CHECK(table.find(0, 2, Press) != nullptr);
+
+    // the dispatch thread finishes its tick: the next reclaim frees the generation
+    profiles.quiescent();
+    CHECK(!mapping.expired());
+    profiles.request(0);
+    CHECK(mapping.expired());
+    CHECK(profiles.table().getActionCount() == 1);
+
+    std::remove(path.c_str());
+
+    return check::result();
+}
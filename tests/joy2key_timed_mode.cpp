@@ -0,0 +1,180 @@
+// author: Daniel Hug, 2022
+
+// short and long press actions of buttons in timed mode, on a virtual clock
+
+#include "joy2key/joy2key_binding.hpp"
+#include "joy2key/joy2key_timer.hpp"
+#include "tests/check.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace hd::j2k;
+using namespace std::chrono_literals;
+using hd::js;
+
+namespace
+{
+
+using Clock = PressTimer::Clock;
+
+Binding makeBinding(unsigned int joystick, unsigned int button, Edge edge, const std::string &name)
+{
+    Binding binding;
+    binding.joystick = joystick;
+    binding.button = button;
+    binding.edge = edge;
+    binding.name = name;
+    binding.keys = {KeyStroke{0, 0, static_cast<std::uint16_t>('A' + button)}};
+    return binding;
+}
+
+js::ButtonEdges pressed(unsigned int button)
+{
+    js::ButtonEdges edges;
+    edges.pressed.set(button, true);
+    return edges;
+}
+
+js::ButtonEdges released(unsigned int button)
+{
+    js::ButtonEdges edges;
+    edges.released.set(button, true);
+    return edges;
+}
+
+js::Event buttonEvent(unsigned int button, bool pressed, Clock::time_point time)
+{
+    js::Event event;
+    event.type = pressed ? js::Event::ButtonPressed : js::Event::ButtonReleased;
+    event.index = static_cast<unsigned char>(button);
+    event.time = time;
+    return event;
+}
+
+// the names of the actions performed, in order
+struct Performed
+{
+    const BindingTable &table;
+    std::vector<std::string> names;
+
+    auto operator()()
+    {
+        return [this](const Action &action) { names.emplace_back(table.name(action)); };
+    }
+};
+
+} // anonymous namespace
+
+int main()
+{
+    Profile profile;
+    profile.name = "timed";
+    profile.longPressTime = 500ms;
+    profile.longPressTimes = {LongPressTime{0, 2, 200ms}};
+    profile.bindings = {makeBinding(0, 1, ShortPress, "short 1"), makeBinding(0, 1, LongPress, "long 1"),
+                        makeBinding(0, 2, ShortPress, "short 2"), makeBinding(0, 2, LongPress, "long 2"),
+                        makeBinding(1, 3, LongPress, "long 3"),   makeBinding(0, 4, Press, "press 4")};
+
+    BindingTable table;
+    if (!CHECK(table.compile(profile)))
+        return check::result();
+
+    PressTimer timer;
+    Performed performed{table, {}};
+    const Clock::time_point t0{};
+
+    // press and release before the long press time: the short press action only
+    table.dispatch(0, pressed(1), t0, timer, performed());
+    CHECK(timer.isArmed(0, 1));
+    CHECK(timer.nextDeadline() == t0 + 500ms);
+    table.expire(t0 + 499ms, timer, performed());
+    table.dispatch(0, released(1), t0 + 499ms, timer, performed());
+    table.expire(t0 + 1000ms, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"short 1"}));
+    CHECK(timer.empty());
+
+    // held past the long press time: the long press action exactly once at its deadline, nothing on release
+    performed.names.clear();
+    table.dispatch(0, pressed(1), t0, timer, performed());
+    table.expire(t0 + 499ms, timer, performed());
+    CHECK(performed.names.empty());
+    table.expire(t0 + 500ms, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"long 1"}));
+    table.expire(t0 + 600ms, timer, performed());
+    table.dispatch(0, released(1), t0 + 700ms, timer, performed());
+    table.expire(t0 + 2000ms, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"long 1"}));
+
+    // the long press time of a button overrides the default of its profile
+    CHECK(table.longPressTime(0, 1) == 500ms);
+    CHECK(table.longPressTime(0, 2) == 200ms);
+    CHECK(table.longPressTime(0, 4) == 0ms);
+    performed.names.clear();
+    table.dispatch(0, pressed(1), t0, timer, performed());
+    table.dispatch(0, pressed(2), t0 + 100ms, timer, performed());
+    CHECK(timer.nextDeadline() == t0 + 300ms);
+    table.expire(t0 + 299ms, timer, performed());
+    CHECK(performed.names.empty());
+    table.expire(t0 + 300ms, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"long 2"}));
+    table.expire(t0 + 500ms, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"long 2", "long 1"}));
+    table.dispatch(0, released(1), t0 + 600ms, timer, performed());
+    table.dispatch(0, released(2), t0 + 600ms, timer, performed());
+    CHECK(performed.names.size() == 2);
+
+    // buttons in immediate mode do not arm a deadline
+    performed.names.clear();
+    table.dispatch(0, pressed(4), t0, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"press 4"}));
+    CHECK(!timer.isArmed(0, 4));
+
+    // disconnecting the joystick cancels its pending deadlines, those of other joysticks stay
+    performed.names.clear();
+    table.dispatch(1, pressed(3), t0, timer, performed());
+    table.dispatch(0, pressed(1), t0, timer, performed());
+    CHECK(timer.size() == 2);
+    timer.cancel(1);
+    CHECK(!timer.isArmed(1, 3));
+    CHECK(timer.isArmed(0, 1));
+    table.expire(t0 + 10s, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"long 1"}));
+    CHECK(timer.empty());
+
+    // events: a tap within one update() does not show in the edges, but is a short press
+    performed.names.clear();
+    table.dispatch(0, std::vector<js::Event>{buttonEvent(1, true, t0), buttonEvent(1, false, t0 + 80ms)}, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"short 1"}));
+    CHECK(timer.empty());
+
+    // events: the press is timed by the device, not by the update() that reads it
+    performed.names.clear();
+    table.dispatch(0, std::vector<js::Event>{buttonEvent(2, true, t0)}, timer, performed());
+    CHECK(timer.deadline(0, 2) == t0 + 200ms);
+    table.expire(t0 + 150ms, timer, performed());
+    table.dispatch(0, std::vector<js::Event>{buttonEvent(2, false, t0 + 190ms)}, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"short 2"}));
+
+    // events: released after the deadline, read before expire(): the long press action, once
+    performed.names.clear();
+    table.dispatch(0, std::vector<js::Event>{buttonEvent(2, true, t0), buttonEvent(2, false, t0 + 250ms)}, timer, performed());
+    table.expire(t0 + 1s, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"long 2"}));
+
+    // events: immediate mode buttons and taps of them perform press and release actions in order
+    performed.names.clear();
+    const std::vector<js::Event> taps{buttonEvent(4, true, t0), buttonEvent(4, false, t0 + 10ms), buttonEvent(4, true, t0 + 20ms)};
+    table.dispatch(0, taps, timer, performed());
+    CHECK((performed.names == std::vector<std::string>{"press 4", "press 4"}));
+    CHECK(timer.empty());
+
+    // a button cannot mix the immediate and the timed mode
+    Profile mixed = profile;
+    mixed.bindings.push_back(makeBinding(0, 1, Press, "press 1"));
+    BindingTable rejected;
+    CHECK(!rejected.compile(mixed));
+
+    return check::result();
+}